@@ -0,0 +1,587 @@
+/*
+ * buffered writeback throttling. loosely based on CoDel. We can't drop
+ * packets for IO scheduling, so the logic is something like this:
+ *
+ * - Monitor read completion latencies in a window. If the minimum
+ *   latency in that window exceeds the target, scale down the number
+ *   of buffered writeback requests we allow in flight, and shrink the
+ *   monitoring window.
+ * - If the window passes with reads and writes completing within the
+ *   target, scale the allowed depth back up.
+ * - A read that has been at the driver for longer than a whole window
+ *   counts as a violation even if nothing completed.
+ *
+ * Only buffered writeback (async writes and discards) is throttled.
+ * Synchronous writes (fsync, journal commits with FLUSH/FUA, O_DIRECT)
+ * and reads are never held back.  The limits are tunable per queue
+ * through the wbt_lat_usec and wbt_win_usec queue attributes.
+ *
+ * Copyright (C) 2016 Jens Axboe
+ */
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include "blk-wbt.h"
+
+enum {
+	/*
+	 * Default depth when unscaled, and the number of consecutive
+	 * sample-less windows before we drift back towards it
+	 */
+	RWB_DEF_DEPTH		= 16,
+	RWB_UNKNOWN_BUMP	= 5,
+
+	/*
+	 * Writes that need to complete in a window before it is
+	 * considered a valid sample
+	 */
+	RWB_MIN_WRITE_SAMPLES	= 3,
+};
+
+/*
+ * Default setting, we'll scale up (to 75% of the request pool) and
+ * down (to 1) from here.
+ */
+#define RWB_WINDOW_NSEC		(100 * 1000 * 1000ULL)
+#define RWB_NONROT_LAT_NSEC	(2 * 1000 * 1000ULL)
+#define RWB_ROT_LAT_NSEC	(75 * 1000 * 1000ULL)
+
+enum {
+	LAT_OK = 1,
+	LAT_UNKNOWN,
+	LAT_UNKNOWN_WRITES,
+	LAT_EXCEEDED,
+};
+
+static inline u64 wbt_now(void)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+/*
+ * Increment @v if it is below @below, returning true if we did
+ */
+static bool atomic_inc_below(atomic_t *v, unsigned int below)
+{
+	int cur = atomic_read(v);
+
+	for (;;) {
+		int old;
+
+		if ((unsigned int) cur >= below)
+			return false;
+		old = atomic_cmpxchg(v, cur, cur + 1);
+		if (old == cur)
+			break;
+		cur = old;
+	}
+
+	return true;
+}
+
+static void rwb_wake_all(struct rq_wb *rwb)
+{
+	if (waitqueue_active(&rwb->wait))
+		wake_up_all(&rwb->wait);
+}
+
+void __wbt_done(struct rq_wb *rwb, unsigned int flags)
+{
+	unsigned int limit;
+	int inflight;
+
+	if (!(flags & WBT_TRACKED))
+		return;
+
+	inflight = atomic_dec_return(&rwb->inflight);
+
+	/*
+	 * wbt got disabled with IO in flight. Wake up any potential
+	 * waiters, we don't have to do more than that.
+	 */
+	if (unlikely(!rwb_enabled(rwb))) {
+		rwb_wake_all(rwb);
+		return;
+	}
+
+	/*
+	 * Don't wake anyone up if we are above the normal limit.
+	 */
+	limit = rwb->wb_normal;
+	if (inflight && inflight >= limit)
+		return;
+
+	if (waitqueue_active(&rwb->wait)) {
+		int diff = limit - inflight;
+
+		if (!inflight || diff >= rwb->wb_background / 2)
+			wake_up_all(&rwb->wait);
+	}
+}
+
+/*
+ * Called on completion of a request, and again when it is freed. Note
+ * that the latter also covers requests that got merged away before
+ * they were ever started.  Must be called with the queue lock held.
+ */
+void wbt_done(struct rq_wb *rwb, struct request *rq)
+{
+	if (!rwb || !rq->wbt_flags)
+		return;
+
+	if (rq->wbt_flags & WBT_TRACKED) {
+		if (rq->wbt_issue_ns)
+			rwb->nr_writes++;
+		__wbt_done(rwb, rq->wbt_flags);
+	} else {
+		if (rwb->sync_cookie == rq) {
+			rwb->sync_issue = 0;
+			rwb->sync_cookie = NULL;
+		}
+
+		if (rq->wbt_issue_ns) {
+			u64 lat = wbt_now() - rq->wbt_issue_ns;
+
+			if (!rwb->nr_reads || lat < rwb->read_lat_min)
+				rwb->read_lat_min = lat;
+			rwb->nr_reads++;
+		}
+		rwb->last_comp = jiffies;
+	}
+
+	rq->wbt_flags = 0;
+	rq->wbt_issue_ns = 0;
+}
+
+/*
+ * Recalculate the allowed depths from the current scale step. Returns
+ * true if we hit the upper bound and can't scale up any further.
+ */
+static bool calc_wb_limits(struct rq_wb *rwb)
+{
+	unsigned int depth;
+	bool ret = false;
+
+	if (!rwb->min_lat_nsec) {
+		rwb->wb_max = rwb->wb_normal = rwb->wb_background = 0;
+		return false;
+	}
+
+	/*
+	 * For step < 0, we don't want to increase/decrease the
+	 * window size beyond what the request pool could hold.
+	 * For step == 0, we are at our default depth.
+	 */
+	depth = RWB_DEF_DEPTH;
+	if (rwb->scale_step > 0) {
+		depth = 1 + ((depth - 1) >> min(31, rwb->scale_step));
+	} else if (rwb->scale_step < 0) {
+		unsigned int maxd = max_t(unsigned int, RWB_DEF_DEPTH,
+					  3 * rwb->q->nr_requests / 4);
+
+		depth = 1 + ((depth - 1) << min(31, -rwb->scale_step));
+		if (depth > maxd) {
+			depth = maxd;
+			ret = true;
+		}
+	}
+
+	/*
+	 * Set our max/normal/bg queue depths based on how far
+	 * we have scaled down (->scale_step).
+	 */
+	rwb->wb_max = depth;
+	rwb->wb_normal = (rwb->wb_max + 1) / 2;
+	rwb->wb_background = (rwb->wb_max + 3) / 4;
+
+	return ret;
+}
+
+static void scale_up(struct rq_wb *rwb)
+{
+	/*
+	 * Hit max in previous round, stop here
+	 */
+	if (rwb->scaled_max)
+		return;
+
+	rwb->scale_step--;
+	rwb->unknown_cnt = 0;
+
+	rwb->scaled_max = calc_wb_limits(rwb);
+
+	rwb_wake_all(rwb);
+}
+
+/*
+ * Scale rwb down. If 'hard_throttle' is set, do it quicker, since we
+ * had a latency violation.
+ */
+static void scale_down(struct rq_wb *rwb, bool hard_throttle)
+{
+	/*
+	 * Stop scaling down when we've hit the limit. This also prevents
+	 * ->scale_step from going to crazy values, if the device can't
+	 * keep up.
+	 */
+	if (rwb->wb_max == 1)
+		return;
+
+	if (rwb->scale_step < 0 && hard_throttle)
+		rwb->scale_step = 0;
+	else
+		rwb->scale_step++;
+
+	rwb->scaled_max = false;
+	rwb->unknown_cnt = 0;
+	calc_wb_limits(rwb);
+}
+
+static int latency_exceeded(struct rq_wb *rwb)
+{
+	u64 thislat = 0;
+
+	/*
+	 * If our stored sync issue exceeds the window size, or it
+	 * exceeds our min target AND we haven't logged any entries,
+	 * flag the latency as exceeded. We work off completion latencies,
+	 * but for a flooded device, a single read can take a long time
+	 * to complete after being issued. If this time exceeds our
+	 * monitoring window AND we didn't see any other completions in
+	 * that window, then count that read as a violation of the latency.
+	 */
+	if (rwb->sync_issue)
+		thislat = wbt_now() - rwb->sync_issue;
+	if (thislat > rwb->cur_win_nsec ||
+	    (thislat > rwb->min_lat_nsec && !rwb->nr_reads))
+		return LAT_EXCEEDED;
+
+	/*
+	 * No read/write mix, if stat isn't valid
+	 */
+	if (!rwb->nr_reads || rwb->nr_writes < RWB_MIN_WRITE_SAMPLES) {
+		/*
+		 * If we had writes in this stat window and the window is
+		 * current, we're only doing writes. If we still have writes
+		 * in flight, consider us doing just writes as well.
+		 */
+		if (rwb->nr_writes || atomic_read(&rwb->inflight))
+			return LAT_UNKNOWN_WRITES;
+		return LAT_UNKNOWN;
+	}
+
+	/*
+	 * If the 'min' latency exceeds our target, step down.
+	 */
+	if (rwb->read_lat_min > rwb->min_lat_nsec)
+		return LAT_EXCEEDED;
+
+	return LAT_OK;
+}
+
+static void rwb_arm_timer(struct rq_wb *rwb)
+{
+	if (rwb->scale_step > 0) {
+		/*
+		 * We should speed this up, using some variant of a fast
+		 * integer inverse square root calculation. Since we only do
+		 * this for every window expiration, it's not a huge deal,
+		 * though.
+		 */
+		rwb->cur_win_nsec = div_u64(rwb->win_nsec << 4,
+					int_sqrt((rwb->scale_step + 1) << 8));
+	} else {
+		/*
+		 * For step < 0, we don't want to increase/decrease the
+		 * window size.
+		 */
+		rwb->cur_win_nsec = rwb->win_nsec;
+	}
+
+	mod_timer(&rwb->window_timer,
+		  jiffies + max_t(unsigned long, 1,
+				  nsecs_to_jiffies(rwb->cur_win_nsec)));
+}
+
+static void wb_timer_fn(unsigned long data)
+{
+	struct rq_wb *rwb = (struct rq_wb *) data;
+	struct request_queue *q = rwb->q;
+	unsigned long flags;
+	int status;
+
+	spin_lock_irqsave(q->queue_lock, flags);
+
+	if (!rwb_enabled(rwb))
+		goto out;
+
+	status = latency_exceeded(rwb);
+
+	switch (status) {
+	case LAT_EXCEEDED:
+		scale_down(rwb, true);
+		break;
+	case LAT_OK:
+		scale_up(rwb);
+		break;
+	case LAT_UNKNOWN_WRITES:
+		/*
+		 * We started at the center step, but don't have a valid
+		 * read/write sample, but we do have writes going on.
+		 * Allow step to go negative, to increase write perf.
+		 */
+		scale_up(rwb);
+		break;
+	case LAT_UNKNOWN:
+		if (++rwb->unknown_cnt < RWB_UNKNOWN_BUMP)
+			break;
+		/*
+		 * We get here when previously scaled reduced depth, and we
+		 * currently don't have a valid read/write sample. For that
+		 * case, slowly return to center state (step == 0).
+		 */
+		if (rwb->scale_step > 0)
+			scale_up(rwb);
+		else if (rwb->scale_step < 0)
+			scale_down(rwb, false);
+		break;
+	default:
+		break;
+	}
+
+	rwb->nr_reads = 0;
+	rwb->nr_writes = 0;
+	rwb->read_lat_min = 0;
+
+	/*
+	 * Re-arm timer, if we have IO in flight
+	 */
+	if (rwb->scale_step > 0 || atomic_read(&rwb->inflight))
+		rwb_arm_timer(rwb);
+out:
+	spin_unlock_irqrestore(q->queue_lock, flags);
+}
+
+static bool close_io(struct rq_wb *rwb)
+{
+	const unsigned long now = jiffies;
+
+	return time_before(now, rwb->last_issue + HZ / 10) ||
+		time_before(now, rwb->last_comp + HZ / 10);
+}
+
+static unsigned int get_limit(struct rq_wb *rwb, unsigned long rw)
+{
+	/*
+	 * If we got disabled, just return UINT_MAX. This ensures that
+	 * we'll properly inc a new IO, and dec+wakeup at the end.
+	 */
+	if (!rwb_enabled(rwb))
+		return UINT_MAX;
+
+	if (rw & REQ_DISCARD)
+		return rwb->wb_background;
+
+	/*
+	 * At this point we know it's a buffered write. WRITE_SYNC is
+	 * somebody waiting on it (journal commit blocks, fsync and
+	 * sync_file_range writeback), and kswapd is trying to free
+	 * memory: let those write at full depth. If there has been
+	 * other read activity recently, keep to the background depth so
+	 * we don't starve it.
+	 */
+	if ((rw & REQ_SYNC) || current_is_kswapd())
+		return rwb->wb_max;
+	if (close_io(rwb))
+		return rwb->wb_background;
+
+	return rwb->wb_normal;
+}
+
+/*
+ * Block if we will exceed our limit, or if we are currently waiting for
+ * the timer to kick off queuing again.
+ */
+static void __wbt_wait(struct rq_wb *rwb, unsigned long rw, spinlock_t *lock)
+{
+	DEFINE_WAIT(wait);
+
+	if (!waitqueue_active(&rwb->wait) &&
+	    atomic_inc_below(&rwb->inflight, get_limit(rwb, rw)))
+		return;
+
+	do {
+		prepare_to_wait_exclusive(&rwb->wait, &wait,
+					  TASK_UNINTERRUPTIBLE);
+
+		if (atomic_inc_below(&rwb->inflight, get_limit(rwb, rw)))
+			break;
+
+		spin_unlock_irq(lock);
+		io_schedule();
+		spin_lock_irq(lock);
+	} while (1);
+
+	finish_wait(&rwb->wait, &wait);
+}
+
+static inline bool wbt_should_throttle(struct bio *bio)
+{
+	const unsigned long rw = bio->bi_rw;
+
+	if (!(rw & REQ_WRITE))
+		return false;
+
+	/*
+	 * Don't throttle WRITE_ODIRECT, or anything that carries a cache
+	 * flush: those are waited on by the submitter, typically for an
+	 * fsync or a journal commit.
+	 */
+	if ((rw & (REQ_SYNC | REQ_NOIDLE)) == REQ_SYNC)
+		return false;
+	if (rw & (REQ_FLUSH | REQ_FUA))
+		return false;
+
+	return true;
+}
+
+/*
+ * Returns the WBT_* flags for the request that will carry @bio. May
+ * sleep, if we need to wait for buffered writeback to drain below the
+ * current limit; @lock is held on entry and on return.
+ */
+unsigned int wbt_wait(struct rq_wb *rwb, struct bio *bio, spinlock_t *lock)
+{
+	if (!rwb_enabled(rwb))
+		return 0;
+
+	if (!wbt_should_throttle(bio)) {
+		if (!(bio->bi_rw & REQ_WRITE)) {
+			rwb->last_issue = jiffies;
+			return WBT_READ;
+		}
+		return 0;
+	}
+
+	__wbt_wait(rwb, bio->bi_rw, lock);
+
+	if (!timer_pending(&rwb->window_timer))
+		rwb_arm_timer(rwb);
+
+	return WBT_TRACKED;
+}
+
+/*
+ * Request handed to the driver, queue lock held
+ */
+void wbt_issue(struct rq_wb *rwb, struct request *rq)
+{
+	if (!rwb || !rq->wbt_flags)
+		return;
+
+	rq->wbt_issue_ns = wbt_now();
+
+	/*
+	 * Track the issue time of a read, so we can react quicker
+	 * if it takes a long time to complete. Note that this is
+	 * just a hint. The request can go away when it completes,
+	 * so it's important we never dereference it. We only use
+	 * the address to compare with, which is why we store the
+	 * sync_issue time locally.
+	 */
+	if ((rq->wbt_flags & WBT_READ) && !rwb->sync_cookie) {
+		rwb->sync_issue = rq->wbt_issue_ns;
+		rwb->sync_cookie = rq;
+	}
+}
+
+void wbt_requeue(struct rq_wb *rwb, struct request *rq)
+{
+	if (!rwb)
+		return;
+
+	if (rwb->sync_cookie == rq) {
+		rwb->sync_issue = 0;
+		rwb->sync_cookie = NULL;
+	}
+	rq->wbt_issue_ns = 0;
+}
+
+static void wbt_update_limits(struct rq_wb *rwb)
+{
+	rwb->scale_step = 0;
+	rwb->scaled_max = false;
+	calc_wb_limits(rwb);
+
+	rwb_wake_all(rwb);
+}
+
+void wbt_set_min_lat(struct request_queue *q, u64 nsec)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	spin_lock_irq(q->queue_lock);
+	rwb->min_lat_nsec = nsec;
+	wbt_update_limits(rwb);
+	spin_unlock_irq(q->queue_lock);
+}
+
+void wbt_set_win(struct request_queue *q, u64 nsec)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	spin_lock_irq(q->queue_lock);
+	rwb->win_nsec = nsec;
+	rwb->cur_win_nsec = nsec;
+	spin_unlock_irq(q->queue_lock);
+}
+
+int wbt_init(struct request_queue *q)
+{
+	struct rq_wb *rwb;
+
+	if (q->rq_wb)
+		return 0;
+
+	rwb = kzalloc(sizeof(*rwb), GFP_KERNEL);
+	if (!rwb)
+		return -ENOMEM;
+
+	atomic_set(&rwb->inflight, 0);
+	init_waitqueue_head(&rwb->wait);
+	setup_timer(&rwb->window_timer, wb_timer_fn, (unsigned long) rwb);
+	rwb->last_comp = rwb->last_issue = jiffies;
+	rwb->q = q;
+	rwb->win_nsec = RWB_WINDOW_NSEC;
+	rwb->cur_win_nsec = RWB_WINDOW_NSEC;
+
+	if (blk_queue_nonrot(q))
+		rwb->min_lat_nsec = RWB_NONROT_LAT_NSEC;
+	else
+		rwb->min_lat_nsec = RWB_ROT_LAT_NSEC;
+
+	spin_lock_irq(q->queue_lock);
+	q->rq_wb = rwb;
+	wbt_update_limits(rwb);
+	spin_unlock_irq(q->queue_lock);
+
+	return 0;
+}
+
+/*
+ * Only called from the queue release path, after all requests are gone
+ */
+void wbt_exit(struct request_queue *q)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	if (rwb) {
+		del_timer_sync(&rwb->window_timer);
+		q->rq_wb = NULL;
+		kfree(rwb);
+	}
+}
@@ -0,0 +1,120 @@
+#ifndef BLK_WBT_H
+#define BLK_WBT_H
+/*
+ * Buffered writeback throttling
+ *
+ * Copyright (C) 2016 Jens Axboe
+ */
+
+#include <linux/kernel.h>
+#include <linux/atomic.h>
+#include <linux/wait.h>
+#include <linux/timer.h>
+#include <linux/blkdev.h>
+
+/*
+ * Per-request tracking state, kept in rq->wbt_flags
+ */
+enum wbt_flags {
+	WBT_TRACKED	= 1,	/* write counted in rwb->inflight */
+	WBT_READ	= 2,	/* read, sampled for completion latency */
+};
+
+struct rq_wb {
+	/*
+	 * Settings that govern how we throttle
+	 */
+	unsigned int wb_background;	/* background writeback */
+	unsigned int wb_normal;		/* normal writeback */
+	unsigned int wb_max;		/* max throughput writeback */
+	int scale_step;
+	bool scaled_max;
+
+	/*
+	 * Number of consecutive windows with no read samples
+	 */
+	unsigned int unknown_cnt;
+
+	u64 win_nsec;			/* default window size */
+	u64 cur_win_nsec;		/* current window size */
+	u64 min_lat_nsec;		/* read latency target, 0 disables */
+
+	struct request_queue *q;
+	struct timer_list window_timer;
+
+	/*
+	 * Samples for the current window, protected by q->queue_lock
+	 */
+	unsigned int nr_reads;
+	unsigned int nr_writes;
+	u64 read_lat_min;
+
+	/*
+	 * Issue time of the oldest read still at the driver
+	 */
+	u64 sync_issue;
+	void *sync_cookie;
+
+	unsigned long last_issue;	/* last non-throttled issue */
+	unsigned long last_comp;	/* last non-throttled comp */
+
+	atomic_t inflight;
+	wait_queue_head_t wait;
+};
+
+#ifdef CONFIG_BLK_WBT
+
+static inline bool rwb_enabled(struct rq_wb *rwb)
+{
+	return rwb && rwb->wb_normal != 0;
+}
+
+static inline void wbt_track(struct request *rq, unsigned int flags)
+{
+	rq->wbt_flags = flags;
+}
+
+unsigned int wbt_wait(struct rq_wb *, struct bio *, spinlock_t *);
+void __wbt_done(struct rq_wb *, unsigned int);
+void wbt_issue(struct rq_wb *, struct request *);
+void wbt_requeue(struct rq_wb *, struct request *);
+void wbt_done(struct rq_wb *, struct request *);
+
+int wbt_init(struct request_queue *);
+void wbt_exit(struct request_queue *);
+void wbt_set_min_lat(struct request_queue *, u64);
+void wbt_set_win(struct request_queue *, u64);
+
+#else
+
+static inline void wbt_track(struct request *rq, unsigned int flags)
+{
+}
+static inline unsigned int wbt_wait(struct rq_wb *rwb, struct bio *bio,
+				    spinlock_t *lock)
+{
+	return 0;
+}
+static inline void __wbt_done(struct rq_wb *rwb, unsigned int flags)
+{
+}
+static inline void wbt_issue(struct rq_wb *rwb, struct request *rq)
+{
+}
+static inline void wbt_requeue(struct rq_wb *rwb, struct request *rq)
+{
+}
+static inline void wbt_done(struct rq_wb *rwb, struct request *rq)
+{
+}
+static inline int wbt_init(struct request_queue *q)
+{
+	return -EINVAL;
+}
+static inline void wbt_exit(struct request_queue *q)
+{
+}
+
+#endif /* CONFIG_BLK_WBT */
+
+#endif
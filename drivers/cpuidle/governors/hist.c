@@ -0,0 +1,239 @@
+/*
+ * hist.c - the histogram idle governor
+ *
+ * This code is licenced under the GPL version 2 as described
+ * in the COPYING file that acompanies the Linux Kernel.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/tick.h>
+#include <linux/module.h>
+
+#define BINS 16
+#define MIN_SAMPLES 32
+#define DECAY_AT 1024
+
+/*
+ * Concepts and ideas behind the histogram governor
+ *
+ * The one wakeup source known before going idle is the next timer
+ * event.  menu scales that by a running correction factor; here we
+ * instead remember, for every order of magnitude of "time to next
+ * timer", how long the CPU really stayed idle.  That is a small
+ * matrix per CPU: row = log2 bin of the next timer, column = log2
+ * bin of the measured idle duration.  Interrupts, IPIs and anything
+ * else that tends to beat the timer show up as mass in the columns
+ * left of the diagonal.
+ *
+ * To select a state we look at the row for the current next timer
+ * and, for each candidate state, count the samples that lasted at
+ * least its target residency.  The deepest state whose hit rate is
+ * at least hit_pct percent wins.  Until a row has MIN_SAMPLES samples
+ * we trust the timer, like menu does on its first use.
+ *
+ * Rows are halved once they hold DECAY_AT samples, so the histogram
+ * follows changes in workload within a few hundred idle periods.
+ */
+
+struct hist_device {
+	int		last_state_idx;
+	int		needs_update;
+
+	unsigned int	expected_us;
+	unsigned int	row;
+	u16		count[BINS][BINS];
+	u16		total[BINS];
+};
+
+static DEFINE_PER_CPU(struct hist_device, hist_devices);
+
+static unsigned int hit_pct = 80;
+module_param(hit_pct, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(hit_pct,
+		 "percentage of past idle periods that must reach a state's target residency");
+
+/* Bin b > 0 holds durations in [2^(b-1), 2^b) us, the last is open */
+static inline unsigned int hist_bin(unsigned int us)
+{
+	return min_t(unsigned int, fls(us), BINS - 1);
+}
+
+static inline unsigned int hist_bin_floor(unsigned int bin)
+{
+	return bin ? 1U << (bin - 1) : 0;
+}
+
+static void hist_update(struct cpuidle_driver *drv, struct cpuidle_device *dev);
+
+/*
+ * Whether enough of the samples in @row stayed idle for at least
+ * @residency us.  Only bins entirely above @residency count.
+ */
+static bool hist_hits(struct hist_device *data, unsigned int row,
+		      unsigned int residency)
+{
+	unsigned int bin, hits = 0;
+
+	for (bin = BINS - 1; bin > 0; bin--) {
+		if (hist_bin_floor(bin) < residency)
+			break;
+		hits += data->count[row][bin];
+	}
+	if (residency == 0)
+		hits += data->count[row][0];
+
+	return hits * 100 >= hit_pct * data->total[row];
+}
+
+/**
+ * hist_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ */
+static int hist_select(struct cpuidle_driver *drv, struct cpuidle_device *dev)
+{
+	struct hist_device *data = &__get_cpu_var(hist_devices);
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	bool learned;
+	int shallowest = -1;
+	int i;
+
+	if (data->needs_update) {
+		hist_update(drv, dev);
+		data->needs_update = 0;
+	}
+
+	data->last_state_idx = CPUIDLE_DRIVER_STATE_START - 1;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	data->expected_us = ktime_to_us(tick_nohz_get_sleep_length());
+	data->row = hist_bin(data->expected_us);
+	learned = data->total[data->row] >= MIN_SAMPLES;
+
+	for (i = CPUIDLE_DRIVER_STATE_START; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+		struct cpuidle_state_usage *su = &dev->states_usage[i];
+
+		if (s->disabled || su->disable)
+			continue;
+		if (shallowest < 0)
+			shallowest = i;
+		if (s->exit_latency > latency_req)
+			continue;
+		/* The timer cuts every idle period short of this */
+		if (s->target_residency > data->expected_us)
+			continue;
+		if (learned && !hist_hits(data, data->row, s->target_residency))
+			continue;
+
+		data->last_state_idx = i;
+	}
+
+	/*
+	 * Never leave the cpu without a state: cpuidle would bail out
+	 * before reflect and the row would stop learning for good.  Like
+	 * menu, settle for the shallowest state the driver lets us use.
+	 */
+	if (data->last_state_idx < CPUIDLE_DRIVER_STATE_START)
+		data->last_state_idx = shallowest >= 0 ? shallowest : 0;
+
+	return data->last_state_idx;
+}
+
+/**
+ * hist_reflect - records that data structures need update
+ * @dev: the CPU
+ * @index: the index of actual entered state
+ */
+static void hist_reflect(struct cpuidle_device *dev, int index)
+{
+	struct hist_device *data = &__get_cpu_var(hist_devices);
+
+	data->last_state_idx = index;
+	if (index >= 0)
+		data->needs_update = 1;
+}
+
+/**
+ * hist_update - adds the last idle period to the histogram
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ */
+static void hist_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
+{
+	struct hist_device *data = &__get_cpu_var(hist_devices);
+	struct cpuidle_state *target = &drv->states[data->last_state_idx];
+	unsigned int measured_us = cpuidle_get_last_residency(dev);
+	u16 *count = data->count[data->row];
+	unsigned int bin;
+
+	/*
+	 * Without residency measurements all we can assume is that the
+	 * timer woke us up, which teaches the histogram nothing new.
+	 */
+	if (unlikely(!(target->flags & CPUIDLE_FLAG_TIME_VALID)))
+		measured_us = data->expected_us;
+	else if (measured_us > target->exit_latency)
+		measured_us -= target->exit_latency;
+
+	if (++data->total[data->row] > DECAY_AT) {
+		data->total[data->row] = 0;
+		for (bin = 0; bin < BINS; bin++) {
+			count[bin] >>= 1;
+			data->total[data->row] += count[bin];
+		}
+		data->total[data->row]++;
+	}
+	count[hist_bin(measured_us)]++;
+}
+
+/**
+ * hist_enable_device - scans a CPU's states and does setup
+ * @drv: cpuidle driver
+ * @dev: the CPU
+ */
+static int hist_enable_device(struct cpuidle_driver *drv,
+			      struct cpuidle_device *dev)
+{
+	struct hist_device *data = &per_cpu(hist_devices, dev->cpu);
+
+	memset(data, 0, sizeof(struct hist_device));
+
+	return 0;
+}
+
+static struct cpuidle_governor hist_governor = {
+	.name =		"hist",
+	.rating =	25,
+	.enable =	hist_enable_device,
+	.select =	hist_select,
+	.reflect =	hist_reflect,
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * init_hist - initializes the governor
+ */
+static int __init init_hist(void)
+{
+	return cpuidle_register_governor(&hist_governor);
+}
+
+/**
+ * exit_hist - exits the governor
+ */
+static void __exit exit_hist(void)
+{
+	cpuidle_unregister_governor(&hist_governor);
+}
+
+MODULE_LICENSE("GPL");
+module_init(init_hist);
+module_exit(exit_hist);
@@ -24,6 +24,8 @@
 #include <linux/major.h>
 #include <linux/device.h>
 #include <linux/cdev.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <linux/wakelock.h>
 #include "input-compat.h"
 
@@ -54,6 +56,20 @@ struct evdev_client {
 	int clkid;
 	unsigned int bufsize;
 	struct input_event *buffer;
+	/*
+	 * Shared ring set up by mmap(); the kernel never trusts the
+	 * user-writable header beyond reading tail.  ring_mutex serialises
+	 * mmap() calls: evdev->mutex can't be used there, as ->mmap runs
+	 * under mmap_sem and evdev->mutex is held across user copies.
+	 */
+	struct mutex ring_mutex;
+	struct input_mmap_ring *ring;
+	struct input_mmap_event *ring_slots;
+	size_t ring_len;
+	unsigned int ring_size;
+	unsigned int ring_head;		/* next slot to fill */
+	unsigned int ring_packet;	/* head as last published */
+	bool ring_overrun;
 };
 
 static void __pass_event(struct evdev_client *client,
@@ -87,6 +103,75 @@ static void __pass_event(struct evdev_client *client,
 	}
 }
 
+static void evdev_ring_put(struct evdev_client *client,
+			   const struct input_event *event)
+{
+	struct input_mmap_event *slot;
+
+	slot = &client->ring_slots[client->ring_head++ &
+				   (client->ring_size - 1)];
+	slot->sec = event->time.tv_sec;
+	slot->usec = event->time.tv_usec;
+	slot->type = event->type;
+	slot->code = event->code;
+	slot->value = event->value;
+}
+
+static void __pass_ring_event(struct evdev_client *client,
+			      const struct input_event *event)
+{
+	struct input_mmap_ring *ring = client->ring;
+	unsigned int need = client->ring_overrun ? 2 : 1;
+	unsigned int tail = ACCESS_ONCE(ring->tail);
+
+	/* Do not overwrite slots before the reader is done with them. */
+	smp_mb();
+
+	if (client->ring_head - tail + need > client->ring_size) {
+		/*
+		 * Throw away the unpublished part of this packet, the
+		 * reader resyncs on the SYN_DROPPED queued next time.
+		 */
+		client->ring_head = client->ring_packet;
+		client->ring_overrun = true;
+		ring->dropped++;
+		return;
+	}
+
+	if (client->ring_overrun) {
+		struct input_event dropped = {
+			.time	= event->time,
+			.type	= EV_SYN,
+			.code	= SYN_DROPPED,
+		};
+
+		evdev_ring_put(client, &dropped);
+		client->ring_overrun = false;
+	}
+	evdev_ring_put(client, event);
+
+	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+		smp_wmb();
+		ring->head = client->ring_packet = client->ring_head;
+		if (client->use_wake_lock)
+			wake_lock(&client->wake_lock);
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+	}
+}
+
+static bool evdev_ring_empty(struct evdev_client *client)
+{
+	return client->ring_packet == ACCESS_ONCE(client->ring->tail);
+}
+
+static bool evdev_client_ready(struct evdev_client *client)
+{
+	if (client->ring)
+		return !evdev_ring_empty(client);
+
+	return client->packet_head != client->tail;
+}
+
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t mono, ktime_t real)
@@ -106,7 +191,10 @@ static void evdev_pass_values(struct evdev_client *client,
 		event.type = v->type;
 		event.code = v->code;
 		event.value = v->value;
-		__pass_event(client, &event);
+		if (client->ring)
+			__pass_ring_event(client, &event);
+		else
+			__pass_event(client, &event);
 		if (v->type == EV_SYN && v->code == SYN_REPORT)
 			wakeup = true;
 	}
@@ -300,6 +388,7 @@ static int evdev_release(struct inode *inode, struct file *file)
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
 
+	vfree(client->ring);
 	kfree(client->buffer);
 	kfree(client);
 
@@ -341,6 +430,7 @@ static int evdev_open(struct inode *inode, struct file *file)
 	client->clkid = CLOCK_MONOTONIC;
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	mutex_init(&client->ring_mutex);
 	snprintf(client->name, sizeof(client->name), "%s-%d",
 			dev_name(&evdev->dev), task_tgid_vnr(current));
 	client->evdev = evdev;
@@ -437,6 +527,10 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		if (!evdev->exist)
 			return -ENODEV;
 
+		/* Events go to the shared ring once it is mapped. */
+		if (client->ring)
+			return -EINVAL;
+
 		if (client->packet_head == client->tail &&
 		    (file->f_flags & O_NONBLOCK))
 			return -EAGAIN;
@@ -463,7 +557,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		if (!(file->f_flags & O_NONBLOCK)) {
 			error = wait_event_interruptible(evdev->wait,
 					client->packet_head != client->tail ||
-					!evdev->exist);
+					client->ring || !evdev->exist);
 			if (error)
 				return error;
 		}
@@ -482,12 +576,96 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	poll_wait(file, &evdev->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->packet_head != client->tail)
+	if (evdev_client_ready(client))
 		mask |= POLLIN | POLLRDNORM;
+	else if (client->ring && client->use_wake_lock) {
+		/* Ring readers never come through evdev_fetch_next_event() */
+		spin_lock_irq(&client->buffer_lock);
+		if (client->use_wake_lock && evdev_ring_empty(client))
+			wake_unlock(&client->wake_lock);
+		spin_unlock_irq(&client->buffer_lock);
+	}
 
 	return mask;
 }
 
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	size_t len = vma->vm_end - vma->vm_start;
+	struct input_mmap_ring *ring;
+	unsigned int size;
+	int retval;
+
+	if (vma->vm_pgoff || !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	retval = mutex_lock_interruptible(&client->ring_mutex);
+	if (retval)
+		return retval;
+
+	if (!evdev->exist) {
+		retval = -ENODEV;
+		goto out;
+	}
+
+	if (client->ring) {
+		/* Any further mapping must cover the same ring. */
+		if (len != client->ring_len)
+			retval = -EINVAL;
+		else
+			retval = remap_vmalloc_range(vma, client->ring, 0);
+		goto out;
+	}
+
+	/* The ring holds no more events than the read() buffer would. */
+	if (len <= PAGE_SIZE || len > PAGE_SIZE +
+	    PAGE_ALIGN(client->bufsize * sizeof(struct input_mmap_event))) {
+		retval = -EINVAL;
+		goto out;
+	}
+	size = (len - PAGE_SIZE) / sizeof(struct input_mmap_event);
+	if (size < EVDEV_MIN_BUFFER_SIZE) {
+		retval = -EINVAL;
+		goto out;
+	}
+	size = min_t(unsigned int, rounddown_pow_of_two(size), client->bufsize);
+
+	ring = vmalloc_user(len);
+	if (!ring) {
+		retval = -ENOMEM;
+		goto out;
+	}
+	ring->size = size;
+	ring->offset = PAGE_SIZE;
+
+	/* Only a ring userspace can see replaces the read() buffer. */
+	retval = remap_vmalloc_range(vma, ring, 0);
+	if (retval) {
+		vfree(ring);
+		goto out;
+	}
+
+	spin_lock_irq(&client->buffer_lock);
+	client->ring_slots = (void *)ring + PAGE_SIZE;
+	client->ring_len = len;
+	client->ring_size = size;
+	client->ring_head = client->ring_packet = 0;
+	client->ring_overrun = false;
+	/* Events still queued for read() are discarded. */
+	client->packet_head = client->tail = client->head;
+	client->ring = ring;
+	spin_unlock_irq(&client->buffer_lock);
+
+	/* Blocked readers have to find out that read() is gone. */
+	wake_up_interruptible(&evdev->wait);
+
+ out:
+	mutex_unlock(&client->ring_mutex);
+	return retval;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -711,7 +889,7 @@ static int evdev_enable_suspend_block(struct evdev *evdev,
 	spin_lock_irq(&client->buffer_lock);
 	wake_lock_init(&client->wake_lock, WAKE_LOCK_SUSPEND, client->name);
 	client->use_wake_lock = true;
-	if (client->packet_head != client->tail)
+	if (evdev_client_ready(client))
 		wake_lock(&client->wake_lock);
 	spin_unlock_irq(&client->buffer_lock);
 	return 0;
@@ -973,6 +1151,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
@@ -993,6 +993,12 @@ struct ext4_inode_info {
 	tid_t i_sync_tid;
 	tid_t i_datasync_tid;
 
+	/*
+	 * Transaction in which the inode last changed metadata outside of
+	 * the on-disk inode itself; fsync can't use a fast commit for it.
+	 */
+	tid_t i_fc_ineligible_tid;
+
 	/* Precomputed uuid+inum+igen checksum for seeding inode checksums */
 	__u32 i_csum_seed;
 };
@@ -1038,6 +1044,7 @@ struct ext4_inode_info {
 #define EXT4_MOUNT_DIOREAD_NOLOCK	0x400000 /* Enable support for dio read nolocking */
 #define EXT4_MOUNT_JOURNAL_CHECKSUM	0x800000 /* Journal checksums */
 #define EXT4_MOUNT_JOURNAL_ASYNC_COMMIT	0x1000000 /* Journal Async Commit */
+#define EXT4_MOUNT_JOURNAL_FAST_COMMIT	0x2000000 /* Journal Fast Commit */
 #define EXT4_MOUNT_DELALLOC		0x8000000 /* Delalloc support */
 #define EXT4_MOUNT_DATA_ERR_ABORT	0x10000000 /* Abort on file data write */
 #define EXT4_MOUNT_BLOCK_VALIDITY	0x20000000 /* Block validity checking */
@@ -1216,6 +1223,24 @@ struct ext4_super_block {
 
 #define EXT4_S_ERR_LEN (EXT4_S_ERR_END - EXT4_S_ERR_START)
 
+/*
+ * Fast commit block, written to the journal's fast commit area by fsync.
+ * It holds a copy of one on-disk inode and is replayed on top of the
+ * recovered log if transaction fc_tid never made it to the journal.
+ */
+#define EXT4_FC_MAGIC		0xEF4FC001
+
+struct ext4_fc_block {
+	__le32	fc_magic;		/* EXT4_FC_MAGIC */
+	__le32	fc_tid;			/* Transaction being fast committed */
+	__le32	fc_off;			/* Index within the fast commit area */
+	__le32	fc_ino;			/* Inode number */
+	__le16	fc_inode_size;		/* Size of the raw inode that follows */
+	__le16	fc_reserved;
+	__le32	fc_checksum;		/* crc32(uuid+fc block) */
+	__u8	fc_raw_inode[0];	/* struct ext4_inode */
+};
+
 #ifdef __KERNEL__
 
 /*
@@ -1319,8 +1344,12 @@ struct ext4_sb_info {
 	unsigned int s_mb_stats;
 	unsigned int s_mb_order2_reqs;
 	unsigned int s_mb_group_prealloc;
+	unsigned int s_mb_optimize_scan;
 	unsigned int s_max_writeback_mb_bump;
 	unsigned int s_max_dir_size_kb;
+	/* groups indexed by the order of their largest free extent */
+	struct list_head *s_mb_largest_free_orders;
+	rwlock_t *s_mb_largest_free_orders_locks;
 	/* where last allocation was done - for stream allocation */
 	unsigned long s_mb_last_group;
 	unsigned long s_mb_last_start;
@@ -1332,6 +1361,8 @@ struct ext4_sb_info {
 	atomic_t s_bal_ex_scanned;	/* total extents scanned */
 	atomic_t s_bal_goals;	/* goal hits */
 	atomic_t s_bal_breaks;	/* too long searches */
+	atomic_t s_bal_groups_scanned;	/* groups locked and scanned */
+	atomic_t s_bal_order_hits;	/* found via largest free order lists */
 	atomic_t s_bal_2orders;	/* 2^order hits */
 	spinlock_t s_bal_lock;
 	unsigned long s_mb_buddies_generated;
@@ -2066,6 +2097,12 @@ static inline  unsigned char get_dtype(struct super_block *sb, int filetype)
 extern int ext4_sync_file(struct file *, loff_t, loff_t, int);
 extern int ext4_flush_unwritten_io(struct inode *);
 
+/* fast_commit.c */
+extern int ext4_fc_init(struct super_block *sb);
+extern int ext4_fc_commit(struct inode *inode, tid_t commit_tid);
+extern int ext4_fc_replay(journal_t *journal, struct buffer_head *bh,
+			  int off, tid_t tid);
+
 /* hash.c */
 extern int ext4fs_dirhash(const char *name, int len, struct
 			  dx_hash_info *hinfo);
@@ -2444,6 +2481,9 @@ struct ext4_group_info {
 	ext4_grpblk_t	bb_free;	/* total free blocks */
 	ext4_grpblk_t	bb_fragments;	/* nr of freespace fragments */
 	ext4_grpblk_t	bb_largest_free_order;/* order of largest frag in BG */
+	ext4_group_t	bb_group;	/* group number */
+	struct		list_head bb_largest_free_order_node; /* on the list of
+					 * groups with this largest order */
 	struct          list_head bb_prealloc_list;
 #ifdef DOUBLE_CHECK
 	void            *bb_bitmap;
@@ -368,6 +368,20 @@ static inline void ext4_update_inode_fsync_trans(handle_t *handle,
 	}
 }
 
+/*
+ * Note that @inode was changed in a way a fast commit cannot describe, so
+ * fsync has to wait for the full commit of the current transaction.
+ */
+static inline void ext4_fc_mark_ineligible(handle_t *handle,
+					   struct inode *inode)
+{
+	if (ext4_handle_valid(handle)) {
+		EXT4_I(inode)->i_fc_ineligible_tid =
+			handle->h_transaction->t_tid;
+		smp_wmb();
+	}
+}
+
 /* super.c */
 int ext4_force_commit(struct super_block *sb);
 
@@ -162,6 +162,7 @@ int __ext4_ext_dirty(const char *where, unsigned int line, handle_t *handle,
 {
 	int err;
 	if (path->p_bh) {
+		ext4_fc_mark_ineligible(handle, inode);
 		ext4_extent_block_csum_set(inode, ext_block_hdr(path->p_bh));
 		/* path points to block */
 		err = __ext4_handle_dirty_metadata(where, line, handle,
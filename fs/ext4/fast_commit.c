@@ -0,0 +1,175 @@
+/*
+ *  linux/fs/ext4/fast_commit.c
+ *
+ * Lightweight fsync for inodes whose pending changes are confined to the
+ * on-disk inode itself (timestamps, size within allocated blocks, in-inode
+ * extent state).  Instead of forcing a full jbd2 commit, fsync writes a
+ * single block holding a copy of the raw inode into the fast commit area
+ * at the end of the journal.  If the running transaction never commits,
+ * recovery copies the inode back into the inode table after replaying the
+ * log.  Anything touching other metadata (allocation, directories, xattr
+ * blocks, orphan list, quota) marks the inode ineligible for the current
+ * transaction and fsync falls back to a full commit.
+ */
+
+#include <linux/fs.h>
+#include <linux/jbd2.h>
+#include <linux/crc32.h>
+#include "ext4.h"
+#include "ext4_jbd2.h"
+
+static __u32 ext4_fc_csum(struct super_block *sb, struct ext4_fc_block *fc)
+{
+	__le32 saved = fc->fc_checksum;
+	__u32 crc;
+
+	fc->fc_checksum = 0;
+	crc = crc32_le(~0, EXT4_SB(sb)->s_es->s_uuid,
+		       sizeof(EXT4_SB(sb)->s_es->s_uuid));
+	crc = crc32_le(crc, (__u8 *)fc,
+		       sizeof(*fc) + le16_to_cpu(fc->fc_inode_size));
+	fc->fc_checksum = saved;
+	return crc;
+}
+
+static int ext4_fc_eligible(struct inode *inode, tid_t tid)
+{
+	if (!S_ISREG(inode->i_mode) || !inode->i_nlink ||
+	    ext4_should_journal_data(inode))
+		return 0;
+	smp_rmb();
+	return EXT4_I(inode)->i_fc_ineligible_tid != tid;
+}
+
+/*
+ * Reserve the fast commit area in the journal.  Called at mount time on a
+ * freshly loaded journal.
+ */
+int ext4_fc_init(struct super_block *sb)
+{
+	if (sb->s_flags & MS_RDONLY)
+		return -EROFS;
+	if (sizeof(struct ext4_fc_block) + EXT4_INODE_SIZE(sb) >
+	    sb->s_blocksize)
+		return -EINVAL;
+	return jbd2_fc_init(EXT4_SB(sb)->s_journal,
+			    JBD2_DEFAULT_FAST_COMMIT_BLOCKS);
+}
+
+/*
+ * Try to make @inode's changes in transaction @commit_tid durable with a
+ * single fast commit block.  Returns 0 on success; any error means the
+ * caller has to wait for the full commit instead.
+ */
+int ext4_fc_commit(struct inode *inode, tid_t commit_tid)
+{
+	struct super_block *sb = inode->i_sb;
+	journal_t *journal = EXT4_SB(sb)->s_journal;
+	int inode_size = EXT4_INODE_SIZE(sb);
+	struct ext4_fc_block *fc;
+	struct buffer_head *bh;
+	struct ext4_iloc iloc;
+	int off, ret;
+
+	if (!test_opt(sb, JOURNAL_FAST_COMMIT) ||
+	    !jbd2_has_fast_commit(journal))
+		return -EOPNOTSUPP;
+	if (!ext4_fc_eligible(inode, commit_tid))
+		return -EAGAIN;
+
+	ret = jbd2_fc_begin_commit(journal, commit_tid);
+	if (ret)
+		return ret;
+
+	ret = ext4_get_inode_loc(inode, &iloc);
+	if (ret)
+		goto out;
+	ret = jbd2_fc_get_buf(journal, &bh, &off);
+	if (ret) {
+		brelse(iloc.bh);
+		goto out;
+	}
+
+	fc = (struct ext4_fc_block *)bh->b_data;
+	fc->fc_magic = cpu_to_le32(EXT4_FC_MAGIC);
+	fc->fc_tid = cpu_to_le32(commit_tid);
+	fc->fc_off = cpu_to_le32(off);
+	fc->fc_ino = cpu_to_le32(inode->i_ino);
+	fc->fc_inode_size = cpu_to_le16(inode_size);
+	memcpy(fc->fc_raw_inode, ext4_raw_inode(&iloc), inode_size);
+	brelse(iloc.bh);
+
+	/*
+	 * Block allocation and friends mark the inode before they update
+	 * the on-disk inode, so if the mark is still clear the copy above
+	 * can't refer to metadata outside of the inode.
+	 */
+	if (!ext4_fc_eligible(inode, commit_tid)) {
+		brelse(bh);
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	fc->fc_checksum = cpu_to_le32(ext4_fc_csum(sb, fc));
+	ret = jbd2_fc_submit_buf(journal, bh);
+out:
+	jbd2_fc_end_commit(journal);
+	return ret;
+}
+
+/*
+ * jbd2 recovery callback: copy a fast committed inode back into the inode
+ * table.  The caller syncs the block device when we're done.
+ */
+int ext4_fc_replay(journal_t *journal, struct buffer_head *bh,
+		   int off, tid_t tid)
+{
+	struct super_block *sb = journal->j_private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_fc_block *fc = (struct ext4_fc_block *)bh->b_data;
+	int inode_size = EXT4_INODE_SIZE(sb);
+	struct ext4_group_desc *gdp;
+	struct buffer_head *itable_bh;
+	unsigned long ino, index;
+	ext4_group_t group;
+	ext4_fsblk_t block;
+
+	if (le32_to_cpu(fc->fc_magic) != EXT4_FC_MAGIC ||
+	    le32_to_cpu(fc->fc_tid) != tid ||
+	    le32_to_cpu(fc->fc_off) != off ||
+	    le16_to_cpu(fc->fc_inode_size) != inode_size ||
+	    le32_to_cpu(fc->fc_checksum) != ext4_fc_csum(sb, fc))
+		return 1;
+
+	ino = le32_to_cpu(fc->fc_ino);
+	if (!ext4_valid_inum(sb, ino)) {
+		ext4_msg(sb, KERN_ERR, "fast commit block %d: bad inode %lu",
+			 off, ino);
+		return -EIO;
+	}
+
+	group = (ino - 1) / EXT4_INODES_PER_GROUP(sb);
+	index = (ino - 1) % EXT4_INODES_PER_GROUP(sb);
+	gdp = ext4_get_group_desc(sb, group, NULL);
+	if (!gdp)
+		return -EIO;
+	block = ext4_inode_table(sb, gdp) + index / sbi->s_inodes_per_block;
+
+	itable_bh = sb_bread(sb, block);
+	if (!itable_bh) {
+		ext4_msg(sb, KERN_ERR, "fast commit block %d: unable to read "
+			 "inode table block %llu", off, block);
+		return -EIO;
+	}
+	lock_buffer(itable_bh);
+	memcpy(itable_bh->b_data +
+	       (index % sbi->s_inodes_per_block) * inode_size,
+	       fc->fc_raw_inode, inode_size);
+	unlock_buffer(itable_bh);
+	mark_buffer_dirty(itable_bh);
+	brelse(itable_bh);
+
+	jbd_debug(1, "EXT4: fast commit replayed inode %lu (tid %u)\n",
+		  ino, tid);
+	return 0;
+}
@@ -4329,6 +4329,11 @@ struct inode *ext4_iget(struct super_block *sb, unsigned long ino)
 		read_unlock(&journal->j_state_lock);
 		ei->i_sync_tid = tid;
 		ei->i_datasync_tid = tid;
+		/*
+		 * We don't know what happened to the inode before it was
+		 * read in, so it can't be fast committed in this transaction.
+		 */
+		ei->i_fc_ineligible_tid = tid;
 	}
 
 	if (EXT4_INODE_SIZE(inode->i_sb) > EXT4_GOOD_OLD_INODE_SIZE) {
@@ -4758,6 +4763,7 @@ int ext4_setattr(struct dentry *dentry, struct iattr *attr)
 			error = PTR_ERR(handle);
 			goto err_out;
 		}
+		ext4_fc_mark_ineligible(handle, inode);
 		error = dquot_transfer(inode, attr);
 		if (error) {
 			ext4_journal_stop(handle);
@@ -698,11 +698,14 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 
 /*
  * Cache the order of the largest free extent we have available in this block
- * group.
+ * group, and keep the group on the matching largest free order list so the
+ * allocator can find it without scanning.  Called with the group locked.
  */
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int old = grp->bb_largest_free_order;
 	int i;
 	int bits;
 
@@ -715,6 +718,23 @@ mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 			break;
 		}
 	}
+
+	if (old == grp->bb_largest_free_order &&
+	    !list_empty(&grp->bb_largest_free_order_node))
+		return;
+
+	if (old >= 0 && !list_empty(&grp->bb_largest_free_order_node)) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[old]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[old]);
+	}
+	i = grp->bb_largest_free_order;
+	if (i >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[i]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[i]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
 }
 
 static noinline_for_stack
@@ -2044,6 +2064,135 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * Try to allocate from @group with criteria @cr.  The group is checked
+ * without its lock first, so unsuitable groups cost neither a buddy load
+ * nor a group lock.
+ */
+static int ext4_mb_scan_group(struct ext4_allocation_context *ac,
+			      struct ext4_buddy *e4b, ext4_group_t group, int cr)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int err;
+
+	/* This now checks without needing the buddy page */
+	if (!ext4_mb_good_group(ac, group, cr))
+		return 0;
+
+	err = ext4_mb_load_buddy(sb, group, e4b);
+	if (err)
+		return err;
+
+	ext4_lock_group(sb, group);
+
+	/*
+	 * We need to check again after locking the
+	 * block group
+	 */
+	if (!ext4_mb_good_group(ac, group, cr)) {
+		ext4_unlock_group(sb, group);
+		ext4_mb_unload_buddy(e4b);
+		return 0;
+	}
+
+	ac->ac_groups_scanned++;
+	if (cr == 0 && ac->ac_2order < sb->s_blocksize_bits+2)
+		ext4_mb_simple_scan_group(ac, e4b);
+	else if (cr == 1 && sbi->s_stripe &&
+			!(ac->ac_g_ex.fe_len % sbi->s_stripe))
+		ext4_mb_scan_aligned(ac, e4b);
+	else
+		ext4_mb_complex_scan_group(ac, e4b);
+
+	ext4_unlock_group(sb, group);
+	ext4_mb_unload_buddy(e4b);
+	return 0;
+}
+
+/*
+ * Smallest largest-free-order a group can have and still satisfy the
+ * request in one piece with criteria @cr, or -1 if the request doesn't fit
+ * the order lists.  For cr 1 a group on order fls(len) - 1 may or may not
+ * have a big enough extent; ext4_mb_good_group() sorts those out.
+ */
+static int ext4_mb_min_order(struct ext4_allocation_context *ac, int cr)
+{
+	int order;
+
+	if (cr == 0)
+		order = ac->ac_2order;
+	else
+		order = fls(ac->ac_g_ex.fe_len) - 1;
+	if (order >= MB_NUM_ORDERS(ac->ac_sb))
+		return -1;
+	return order;
+}
+
+static inline int ext4_mb_order_indexed(struct ext4_allocation_context *ac,
+					int cr)
+{
+	return ext4_mb_min_order(ac, cr) >= 0;
+}
+
+/*
+ * Offer the groups whose largest free extent is big enough for the
+ * request, smallest order first.  Group numbers are picked off each list
+ * in small batches under the list lock, which is dropped before any
+ * buddy is loaded or group lock taken.
+ */
+static int ext4_mb_scan_by_order(struct ext4_allocation_context *ac,
+				 struct ext4_buddy *e4b, int cr,
+				 ext4_group_t ngroups)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	ext4_group_t batch[MB_ORDER_SCAN_BATCH];
+	struct ext4_group_info *grp;
+	int order, min_order, nr, skip, pos, i;
+	int err;
+
+	min_order = ext4_mb_min_order(ac, cr);
+	if (min_order < 0)
+		return 0;
+
+	for (order = min_order; order < MB_NUM_ORDERS(sb); order++) {
+		skip = 0;
+		do {
+			nr = 0;
+			pos = 0;
+			read_lock(&sbi->s_mb_largest_free_orders_locks[order]);
+			list_for_each_entry(grp,
+					&sbi->s_mb_largest_free_orders[order],
+					bb_largest_free_order_node) {
+				if (pos++ < skip)
+					continue;
+				if (grp->bb_group >= ngroups ||
+				    EXT4_MB_GRP_NEED_INIT(grp) ||
+				    !ext4_mb_good_group(ac, grp->bb_group, cr))
+					continue;
+				batch[nr++] = grp->bb_group;
+				if (nr == MB_ORDER_SCAN_BATCH)
+					break;
+			}
+			read_unlock(&sbi->s_mb_largest_free_orders_locks[order]);
+			skip = pos;
+
+			for (i = 0; i < nr; i++) {
+				err = ext4_mb_scan_group(ac, e4b, batch[i], cr);
+				if (err)
+					return err;
+				if (ac->ac_status != AC_STATUS_CONTINUE) {
+					if (sbi->s_mb_stats)
+						atomic_inc(&sbi->s_bal_order_hits);
+					return 0;
+				}
+			}
+		} while (nr == MB_ORDER_SCAN_BATCH);
+	}
+	return 0;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
@@ -2053,6 +2202,10 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 	struct ext4_sb_info *sbi;
 	struct super_block *sb;
 	struct ext4_buddy e4b;
+	ktime_t start = { .tv64 = 0 };
+
+	if (trace_ext4_mballoc_regular_allocator_enabled())
+		start = ktime_get();
 
 	sb = ac->ac_sb;
 	sbi = EXT4_SB(sb);
@@ -2115,6 +2268,14 @@ repeat:
 		 */
 		group = ac->ac_g_ex.fe_group;
 
+		if (cr <= 1 && sbi->s_mb_optimize_scan) {
+			err = ext4_mb_scan_by_order(ac, &e4b, cr, ngroups);
+			if (err)
+				goto out;
+			if (ac->ac_status != AC_STATUS_CONTINUE)
+				break;
+		}
+
 		for (i = 0; i < ngroups; group++, i++) {
 			/*
 			 * Artificially restricted ngroups for non-extent
@@ -2123,37 +2284,19 @@ repeat:
 			if (group >= ngroups)
 				group = 0;
 
-			/* This now checks without needing the buddy page */
-			if (!ext4_mb_good_group(ac, group, cr))
-				continue;
-
-			err = ext4_mb_load_buddy(sb, group, &e4b);
-			if (err)
-				goto out;
-
-			ext4_lock_group(sb, group);
-
 			/*
-			 * We need to check again after locking the
-			 * block group
+			 * Initialized groups were already offered by the
+			 * largest free order lists, only look at the rest.
 			 */
-			if (!ext4_mb_good_group(ac, group, cr)) {
-				ext4_unlock_group(sb, group);
-				ext4_mb_unload_buddy(&e4b);
+			if (cr <= 1 && sbi->s_mb_optimize_scan &&
+			    ext4_mb_order_indexed(ac, cr) &&
+			    !EXT4_MB_GRP_NEED_INIT(ext4_get_group_info(sb,
+								       group)))
 				continue;
-			}
-
-			ac->ac_groups_scanned++;
-			if (cr == 0 && ac->ac_2order < sb->s_blocksize_bits+2)
-				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
-			else
-				ext4_mb_complex_scan_group(ac, &e4b);
 
-			ext4_unlock_group(sb, group);
-			ext4_mb_unload_buddy(&e4b);
+			err = ext4_mb_scan_group(ac, &e4b, group, cr);
+			if (err)
+				goto out;
 
 			if (ac->ac_status != AC_STATUS_CONTINUE)
 				break;
@@ -2186,6 +2329,9 @@ repeat:
 		}
 	}
 out:
+	if (trace_ext4_mballoc_regular_allocator_enabled())
+		trace_ext4_mballoc_regular_allocator(ac,
+				ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return err;
 }
 
@@ -2394,6 +2540,8 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
 
 #ifdef DOUBLE_CHECK
 	{
@@ -2543,6 +2691,23 @@ int ext4_mb_init(struct super_block *sb)
 		goto out;
 	}
 
+	i = MB_NUM_ORDERS(sb) * sizeof(*sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	i = MB_NUM_ORDERS(sb) * sizeof(*sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders_locks == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+
 	ret = ext4_groupinfo_create_slab(sb->s_blocksize);
 	if (ret < 0)
 		goto out;
@@ -2572,6 +2737,7 @@ int ext4_mb_init(struct super_block *sb)
 	sbi->s_mb_stats = MB_DEFAULT_STATS;
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
+	sbi->s_mb_optimize_scan = MB_DEFAULT_OPTIMIZE_SCAN;
 	/*
 	 * The default group preallocation is 512, which for 4k block
 	 * sizes translates to 2 megabytes.  However for bigalloc file
@@ -2630,6 +2796,10 @@ out_free_locality_groups:
 out_free_groupinfo_slab:
 	ext4_groupinfo_destroy_slabs();
 out:
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -2685,6 +2855,8 @@ int ext4_mb_release(struct super_block *sb)
 			kfree(sbi->s_group_info[i]);
 		ext4_kvfree(sbi->s_group_info);
 	}
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	if (sbi->s_buddy_cache)
@@ -2703,6 +2875,10 @@ int ext4_mb_release(struct super_block *sb)
 				atomic_read(&sbi->s_bal_2orders),
 				atomic_read(&sbi->s_bal_breaks),
 				atomic_read(&sbi->s_mb_lost_chunks));
+		ext4_msg(sb, KERN_INFO,
+		       "mballoc: %u groups scanned, %u order list hits",
+				atomic_read(&sbi->s_bal_groups_scanned),
+				atomic_read(&sbi->s_bal_order_hits));
 		ext4_msg(sb, KERN_INFO,
 		       "mballoc: %lu generated and it took %Lu",
 				sbi->s_mb_buddies_generated,
@@ -3174,6 +3350,7 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 	if (sbi->s_mb_stats && ac->ac_g_ex.fe_len > 1) {
 		atomic_inc(&sbi->s_bal_reqs);
 		atomic_add(ac->ac_b_ex.fe_len, &sbi->s_bal_allocated);
+		atomic_add(ac->ac_groups_scanned, &sbi->s_bal_groups_scanned);
 		if (ac->ac_b_ex.fe_len >= ac->ac_o_ex.fe_len)
 			atomic_inc(&sbi->s_bal_success);
 		atomic_add(ac->ac_found, &sbi->s_bal_ex_scanned);
@@ -4386,6 +4563,7 @@ ext4_fsblk_t ext4_mb_new_blocks(handle_t *handle,
 	sbi = EXT4_SB(sb);
 
 	trace_ext4_request_blocks(ar);
+	ext4_fc_mark_ineligible(handle, ar->inode);
 
 	/* Allow to use superuser reservation for quota file */
 	if (IS_NOQUOTA(ar->inode))
@@ -4643,6 +4821,7 @@ void ext4_free_blocks(handle_t *handle, struct inode *inode,
 
 	ext4_debug("freeing block %llu\n", block);
 	trace_ext4_free_blocks(inode, block, count, flags);
+	ext4_fc_mark_ineligible(handle, inode);
 
 	if (flags & EXT4_FREE_BLOCKS_FORGET) {
 		struct buffer_head *tbh = bh;
@@ -89,6 +89,19 @@ extern ushort ext4_mballoc_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * Pick groups for 2^N and cr 1 requests from the largest free order
+ * lists instead of scanning groups linearly from the goal.
+ */
+#define MB_DEFAULT_OPTIMIZE_SCAN	1
+
+/*
+ * Number of groups taken off a largest free order list at a time
+ */
+#define MB_ORDER_SCAN_BATCH		8
+
+#define MB_NUM_ORDERS(sb)		((sb)->s_blocksize_bits + 2)
+
 
 struct ext4_free_data {
 	/* MUST be the first member */
@@ -109,6 +109,30 @@ struct fuse_inode {
 
 	/** Miscellaneous bits describing inode state */
 	unsigned long state;
+
+	/** Readdir cache, kept in the directory's page cache */
+	struct {
+		/** true if fully cached */
+		bool cached;
+
+		/** size of cache */
+		loff_t size;
+
+		/** position at end of cache (position of next entry) */
+		loff_t pos;
+
+		/** version of the cache */
+		u64 version;
+
+		/** modification time of directory when cache was started */
+		struct timespec mtime;
+
+		/** i_version of directory when cache was started */
+		u64 iversion;
+
+		/** protects above fields */
+		spinlock_t lock;
+	} rdc;
 };
 
 /** FUSE inode state bits */
@@ -153,6 +177,18 @@ struct fuse_file {
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
 
+	/** Readdir related, protected by the directory's i_mutex */
+	struct {
+		/** Dir stream position */
+		loff_t pos;
+
+		/** Offset in cache */
+		loff_t cache_off;
+
+		/** Version of cache we are reading */
+		u64 version;
+	} readdir;
+
 	/** Has flock been performed on this file? */
 	bool flock:1;
 };
@@ -393,6 +429,10 @@ struct fuse_conn {
 	/** Maximum read size */
 	unsigned max_read;
 
+	/** Time in seconds to cache negative lookups the daemon gave no
+	    timeout for, 0 to not cache them */
+	unsigned negative_timeout;
+
 	/** Maximum write size */
 	unsigned max_write;
 
@@ -831,6 +871,11 @@ u64 fuse_lock_owner_id(struct fuse_conn *fc, fl_owner_t id);
 int fuse_update_attributes(struct inode *inode, struct kstat *stat,
 			   struct file *file, bool *refreshed);
 
+/**
+ * Directory contents changed: drop cached attributes and the readdir cache
+ */
+void fuse_dir_changed(struct inode *dir);
+
 void fuse_flush_writepages(struct inode *inode);
 
 void fuse_set_nowrite(struct inode *inode);
@@ -51,6 +51,9 @@ MODULE_PARM_DESC(max_user_congthresh,
 
 #define FUSE_DEFAULT_BLKSIZE 512
 
+/** Upper bound on the negative_timeout mount option, in seconds */
+#define FUSE_MAX_NEGATIVE_TIMEOUT 60
+
 /** Maximum number of outstanding background requests */
 #define FUSE_DEFAULT_MAX_BACKGROUND 12
 
@@ -69,6 +72,7 @@ struct fuse_mount_data {
 	unsigned flags;
 	unsigned max_read;
 	unsigned blksize;
+	unsigned negative_timeout;
 };
 
 struct fuse_forget_link *fuse_alloc_forget(void)
@@ -93,6 +97,11 @@ static struct inode *fuse_alloc_inode(struct super_block *sb)
 	fi->writectr = 0;
 	fi->orig_ino = 0;
 	fi->state = 0;
+	fi->rdc.cached = false;
+	fi->rdc.size = 0;
+	fi->rdc.pos = 0;
+	fi->rdc.version = 0;
+	spin_lock_init(&fi->rdc.lock);
 	INIT_LIST_HEAD(&fi->write_files);
 	INIT_LIST_HEAD(&fi->queued_writes);
 	INIT_LIST_HEAD(&fi->writepages);
@@ -446,6 +455,7 @@ enum {
 	OPT_ALLOW_OTHER,
 	OPT_MAX_READ,
 	OPT_BLKSIZE,
+	OPT_NEGATIVE_TIMEOUT,
 	OPT_ERR
 };
 
@@ -458,6 +468,7 @@ static const match_table_t tokens = {
 	{OPT_ALLOW_OTHER,		"allow_other"},
 	{OPT_MAX_READ,			"max_read=%u"},
 	{OPT_BLKSIZE,			"blksize=%u"},
+	{OPT_NEGATIVE_TIMEOUT,		"negative_timeout=%u"},
 	{OPT_ERR,			NULL}
 };
 
@@ -543,6 +554,13 @@ static int parse_fuse_opt(char *opt, struct fuse_mount_data *d, int is_bdev)
 			d->blksize = value;
 			break;
 
+		case OPT_NEGATIVE_TIMEOUT:
+			if (match_int(&args[0], &value) || value < 0)
+				return 0;
+			d->negative_timeout = min_t(unsigned, value,
+						    FUSE_MAX_NEGATIVE_TIMEOUT);
+			break;
+
 		default:
 			return 0;
 		}
@@ -570,6 +588,8 @@ static int fuse_show_options(struct seq_file *m, struct dentry *root)
 		seq_printf(m, ",max_read=%u", fc->max_read);
 	if (sb->s_bdev && sb->s_blocksize != FUSE_DEFAULT_BLKSIZE)
 		seq_printf(m, ",blksize=%lu", sb->s_blocksize);
+	if (fc->negative_timeout)
+		seq_printf(m, ",negative_timeout=%u", fc->negative_timeout);
 	return 0;
 }
 
@@ -1047,6 +1067,7 @@ static int fuse_fill_super(struct super_block *sb, void *data, int silent)
 	fc->user_id = d.user_id;
 	fc->group_id = d.group_id;
 	fc->max_read = max_t(unsigned, 4096, d.max_read);
+	fc->negative_timeout = d.negative_timeout;
 
 	/* Used by get_root_inode() */
 	sb->s_fs_info = fc;
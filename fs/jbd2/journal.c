@@ -41,6 +41,7 @@
 #include <linux/log2.h>
 #include <linux/vmalloc.h>
 #include <linux/backing-dev.h>
+#include <linux/blkdev.h>
 #include <linux/bitops.h>
 #include <linux/ratelimit.h>
 
@@ -1076,6 +1077,7 @@ static journal_t * journal_init_common (void)
 	init_waitqueue_head(&journal->j_wait_updates);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
+	mutex_init(&journal->j_fc_mutex);
 	spin_lock_init(&journal->j_revoke_lock);
 	spin_lock_init(&journal->j_list_lock);
 	rwlock_init(&journal->j_state_lock);
@@ -1281,6 +1283,8 @@ static int journal_reset(journal_t *journal)
 
 	journal->j_first = first;
 	journal->j_last = last;
+	journal->j_fc_first = last;
+	journal->j_fc_last = journal->j_maxlen;
 
 	journal->j_head = first;
 	journal->j_tail = first;
@@ -1460,6 +1464,238 @@ void jbd2_journal_update_sb_errno(journal_t *journal)
 }
 EXPORT_SYMBOL(jbd2_journal_update_sb_errno);
 
+/**
+ * int jbd2_fc_init() - Reserve a fast commit area behind the log.
+ * @journal: Journal to act on.
+ * @num_fc_blks: Number of blocks to reserve.
+ *
+ * The fast commit area takes the last @num_fc_blks blocks of the journal
+ * away from the log.  s_maxlen shrinks by the same amount, so e2fsck and
+ * kernels that don't know about the area see a valid, shorter journal and
+ * no new feature bit.  This must be done on a freshly loaded, empty
+ * journal and the superblock is written out immediately, so that recovery
+ * always agrees with us about where the log wraps.
+ */
+int jbd2_fc_init(journal_t *journal, unsigned int num_fc_blks)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	unsigned long maxlen = be32_to_cpu(sb->s_maxlen);
+	int err;
+
+	if (jbd2_has_fast_commit(journal))
+		return 0;
+	if (journal->j_format_version < 2 ||
+	    !num_fc_blks || num_fc_blks > journal->j_maxlen / 4 ||
+	    journal->j_first + JBD2_MIN_JOURNAL_BLOCKS + num_fc_blks > maxlen)
+		return -EINVAL;
+
+	write_lock(&journal->j_state_lock);
+	if (journal->j_running_transaction ||
+	    journal->j_committing_transaction ||
+	    journal->j_head != journal->j_first) {
+		write_unlock(&journal->j_state_lock);
+		return -EBUSY;
+	}
+	journal->j_last = maxlen - num_fc_blks;
+	journal->j_free = journal->j_last - journal->j_first;
+	journal->j_fc_first = journal->j_last;
+	journal->j_fc_last = maxlen;
+	journal->j_fc_off = 0;
+	journal->j_fc_tid = 0;
+	write_unlock(&journal->j_state_lock);
+
+	mutex_lock(&journal->j_checkpoint_mutex);
+	sb->s_maxlen = cpu_to_be32(maxlen - num_fc_blks);
+	sb->s_inode_fc_blks = cpu_to_be32(num_fc_blks);
+	err = jbd2_write_superblock(journal, WRITE_FUA);
+	mutex_unlock(&journal->j_checkpoint_mutex);
+	return err;
+}
+EXPORT_SYMBOL(jbd2_fc_init);
+
+/**
+ * int jbd2_fc_begin_commit() - Start a fast commit for a transaction.
+ * @journal: Journal to act on.
+ * @tid: Transaction whose updates are being recorded.
+ *
+ * Fast commit blocks are only ever replayed on top of a completely
+ * recovered log, so @tid must still be the running transaction and any
+ * older transaction has to reach the disk first.  On success this returns
+ * 0 with the fast commit area locked; the caller must release it with
+ * jbd2_fc_end_commit().  -EINVAL means @tid is no longer running and the
+ * caller should fall back to waiting for the regular commit.
+ */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid)
+{
+	tid_t committing_tid = 0;
+	int committing = 0;
+	int err = 0;
+
+	if (!jbd2_has_fast_commit(journal))
+		return -EOPNOTSUPP;
+
+	mutex_lock(&journal->j_fc_mutex);
+	read_lock(&journal->j_state_lock);
+	if (is_journal_aborted(journal) ||
+	    !journal->j_running_transaction ||
+	    journal->j_running_transaction->t_tid != tid) {
+		read_unlock(&journal->j_state_lock);
+		mutex_unlock(&journal->j_fc_mutex);
+		return -EINVAL;
+	}
+	if (journal->j_committing_transaction) {
+		committing_tid = journal->j_committing_transaction->t_tid;
+		committing = 1;
+	}
+	read_unlock(&journal->j_state_lock);
+
+	if (committing) {
+		err = jbd2_log_wait_commit(journal, committing_tid);
+		if (err) {
+			mutex_unlock(&journal->j_fc_mutex);
+			return err;
+		}
+	}
+
+	/*
+	 * Recovery skips a log marked empty (s_start == 0) altogether, so a
+	 * fast commit made before the first full commit after mount or
+	 * jbd2_journal_flush() would never be replayed.  Write the log tail
+	 * out now, just as that commit would have done.
+	 */
+	if (journal->j_flags & JBD2_FLUSHED) {
+		mutex_lock(&journal->j_checkpoint_mutex);
+		if (journal->j_flags & JBD2_FLUSHED)
+			err = jbd2_journal_update_sb_log_tail(journal,
+						journal->j_tail_sequence,
+						journal->j_tail, WRITE_FUA);
+		mutex_unlock(&journal->j_checkpoint_mutex);
+		if (err) {
+			mutex_unlock(&journal->j_fc_mutex);
+			return err;
+		}
+	}
+
+	/* The area is reused from the start by every new transaction */
+	if (journal->j_fc_tid != tid) {
+		journal->j_fc_tid = tid;
+		journal->j_fc_off = 0;
+	}
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_begin_commit);
+
+/**
+ * int jbd2_fc_get_buf() - Get the next free fast commit block.
+ * @journal: Journal to act on.
+ * @bh_out: Returns a zeroed, uptodate buffer for the block.
+ * @off: Returns the index of the block within the fast commit area.
+ *
+ * The block is only accounted for once jbd2_fc_submit_buf() has written it,
+ * so a caller that gives up simply drops the buffer and the next fast
+ * commit reuses the slot.  Returns -ENOSPC once the area is full for the
+ * current transaction.
+ */
+int jbd2_fc_get_buf(journal_t *journal, struct buffer_head **bh_out, int *off)
+{
+	unsigned long long pblock;
+	struct buffer_head *bh;
+	int err;
+
+	BUG_ON(!mutex_is_locked(&journal->j_fc_mutex));
+	if (journal->j_fc_first + journal->j_fc_off >= journal->j_fc_last)
+		return -ENOSPC;
+
+	err = jbd2_journal_bmap(journal,
+				journal->j_fc_first + journal->j_fc_off,
+				&pblock);
+	if (err)
+		return err;
+
+	bh = __getblk(journal->j_dev, pblock, journal->j_blocksize);
+	if (!bh)
+		return -ENOMEM;
+
+	lock_buffer(bh);
+	memset(bh->b_data, 0, journal->j_blocksize);
+	set_buffer_uptodate(bh);
+	unlock_buffer(bh);
+
+	*off = journal->j_fc_off;
+	*bh_out = bh;
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_get_buf);
+
+/**
+ * int jbd2_fc_submit_buf() - Write a fast commit block and wait for it.
+ * @journal: Journal to act on.
+ * @bh: Buffer obtained from jbd2_fc_get_buf().  The reference is dropped.
+ *
+ * The block goes out with a cache flush in front of it, so the file data
+ * written before the fast commit is stable once this returns.
+ */
+int jbd2_fc_submit_buf(journal_t *journal, struct buffer_head *bh)
+{
+	int write_op = WRITE_SYNC;
+	int err = 0;
+
+	if (journal->j_flags & JBD2_BARRIER) {
+		if (journal->j_fs_dev != journal->j_dev) {
+			err = blkdev_issue_flush(journal->j_fs_dev, GFP_NOFS,
+						 NULL);
+			if (err)
+				goto out;
+		}
+		write_op = WRITE_FLUSH_FUA;
+	}
+
+	lock_buffer(bh);
+	clear_buffer_dirty(bh);
+	get_bh(bh);
+	bh->b_end_io = end_buffer_write_sync;
+	submit_bh(write_op, bh);
+	wait_on_buffer(bh);
+	if (!buffer_uptodate(bh))
+		err = -EIO;
+	else
+		journal->j_fc_off++;
+out:
+	brelse(bh);
+	return err;
+}
+EXPORT_SYMBOL(jbd2_fc_submit_buf);
+
+/*
+ * Give the fast commit area back to the log on a clean unmount.  The log
+ * has just been checkpointed and marked empty, so nothing in the area can
+ * be needed any more.  A later mount with fast commits enabled reserves
+ * the area again in jbd2_fc_init().
+ */
+static void jbd2_fc_release(journal_t *journal)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+
+	BUG_ON(!mutex_is_locked(&journal->j_checkpoint_mutex));
+	if (!jbd2_has_fast_commit(journal) || bdev_read_only(journal->j_dev))
+		return;
+
+	jbd_debug(1, "JBD2: Releasing fast commit area\n");
+	sb->s_maxlen = cpu_to_be32(journal->j_maxlen);
+	sb->s_inode_fc_blks = 0;
+	jbd2_write_superblock(journal, WRITE_FUA);
+}
+
+/**
+ * void jbd2_fc_end_commit() - Release the fast commit area.
+ * @journal: Journal to act on.
+ */
+void jbd2_fc_end_commit(journal_t *journal)
+{
+	mutex_unlock(&journal->j_fc_mutex);
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit);
+
 /*
  * Read the superblock for a given journal, performing initial
  * validation of the format.
@@ -1508,11 +1744,28 @@ static int journal_get_superblock(journal_t *journal)
 		goto out;
 	}
 
-	if (be32_to_cpu(sb->s_maxlen) < journal->j_maxlen)
-		journal->j_maxlen = be32_to_cpu(sb->s_maxlen);
-	else if (be32_to_cpu(sb->s_maxlen) > journal->j_maxlen) {
+	if (be32_to_cpu(sb->s_maxlen) < journal->j_maxlen) {
+		unsigned int fc_blks = be32_to_cpu(sb->s_inode_fc_blks);
+
+		/*
+		 * The fast commit area lives in the blocks right behind
+		 * s_maxlen, so to anything that doesn't know about it the
+		 * journal just looks shorter.  A size that doesn't fit is
+		 * left over from a journal that was since recreated.
+		 */
+		if (fc_blks &&
+		    be32_to_cpu(sb->s_maxlen) + fc_blks <= journal->j_maxlen &&
+		    fc_blks <= be32_to_cpu(sb->s_maxlen) / 4) {
+			journal->j_maxlen = be32_to_cpu(sb->s_maxlen) + fc_blks;
+		} else {
+			journal->j_maxlen = be32_to_cpu(sb->s_maxlen);
+			sb->s_inode_fc_blks = 0;
+		}
+	} else if (be32_to_cpu(sb->s_maxlen) > journal->j_maxlen) {
 		printk(KERN_WARNING "JBD2: journal file too short\n");
 		goto out;
+	} else {
+		sb->s_inode_fc_blks = 0;
 	}
 
 	if (be32_to_cpu(sb->s_first) == 0 ||
@@ -1587,6 +1840,8 @@ static int load_superblock(journal_t *journal)
 	journal->j_tail = be32_to_cpu(sb->s_start);
 	journal->j_first = be32_to_cpu(sb->s_first);
 	journal->j_last = be32_to_cpu(sb->s_maxlen);
+	journal->j_fc_first = journal->j_last;
+	journal->j_fc_last = journal->j_maxlen;
 	journal->j_errno = be32_to_cpu(sb->s_errno);
 
 	return 0;
@@ -1705,6 +1960,7 @@ int jbd2_journal_destroy(journal_t *journal)
 			write_unlock(&journal->j_state_lock);
 
 			jbd2_mark_journal_empty(journal, WRITE_FLUSH_FUA);
+			jbd2_fc_release(journal);
 			mutex_unlock(&journal->j_checkpoint_mutex);
 		} else
 			err = -EIO;
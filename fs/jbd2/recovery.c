@@ -233,6 +233,37 @@ do {									\
 		var -= ((journal)->j_last - (journal)->j_first);	\
 } while (0)
 
+/*
+ * Hand the fast commit area to the client filesystem once the log itself
+ * has been replayed.  Only the first transaction missing from the log
+ * (@tid) can own valid fast commit blocks; the client checks that and
+ * tells us when to stop.
+ */
+static int fc_do_replay(journal_t *journal, tid_t tid)
+{
+	struct buffer_head *bh;
+	unsigned long blocknr;
+	int off = 0, err = 0;
+
+	if (!jbd2_has_fast_commit(journal) || !journal->j_fc_replay_callback)
+		return 0;
+
+	for (blocknr = journal->j_fc_first; blocknr < journal->j_fc_last;
+	     blocknr++, off++) {
+		err = jread(&bh, journal, blocknr);
+		if (err)
+			break;
+		err = journal->j_fc_replay_callback(journal, bh, off, tid);
+		brelse(bh);
+		if (err)
+			break;
+	}
+
+	jbd_debug(1, "JBD2: fast commit replay of transaction %u stopped "
+		  "at block %d\n", tid, off);
+	return err < 0 ? err : 0;
+}
+
 /**
  * jbd2_journal_recover - recovers a on-disk journal
  * @journal: the journal to recover
@@ -273,6 +304,8 @@ int jbd2_journal_recover(journal_t *journal)
 		err = do_one_pass(journal, &info, PASS_REVOKE);
 	if (!err)
 		err = do_one_pass(journal, &info, PASS_REPLAY);
+	if (!err)
+		err = fc_do_replay(journal, info.end_transaction);
 
 	jbd_debug(1, "JBD2: recovery, exit status %d, "
 		  "recovered transactions %u to %u\n",
@@ -21,6 +21,87 @@
 #include "sdcardfs.h"
 #include "linux/ctype.h"
 
+/*
+ * RCU-walk revalidation: the same checks as the ref-walk path below, but
+ * without taking references. The dentry, its parent and the lower dentries
+ * stay allocated for as long as the walk holds rcu_read_lock(), and the
+ * private data is RCU freed, so their fields can be read under the
+ * respective spinlocks. Obb graft dentries and anything the lower file
+ * system cannot decide without blocking are left to ref-walk.
+ */
+static int sdcardfs_d_revalidate_rcu(struct dentry *dentry, unsigned int flags)
+{
+	struct sdcardfs_dentry_info *di, *pdi;
+	struct dentry *parent, *lower_dentry, *parent_lower_dentry;
+	struct sdcardfs_inode_data *data;
+	struct inode *inode;
+	int err = 1;
+
+	parent = ACCESS_ONCE(dentry->d_parent);
+	if (parent == dentry)
+		return 1;
+
+	di = ACCESS_ONCE(dentry->d_fsdata);
+	pdi = ACCESS_ONCE(parent->d_fsdata);
+	if (!di || !pdi)
+		return -ECHILD;
+
+	spin_lock(&di->lock);
+	lower_dentry = di->orig_path.dentry ? NULL : di->lower_path.dentry;
+	spin_unlock(&di->lock);
+	if (!lower_dentry)
+		return -ECHILD;
+
+	spin_lock(&pdi->lock);
+	parent_lower_dentry = pdi->lower_path.dentry;
+	spin_unlock(&pdi->lock);
+
+	if ((lower_dentry->d_flags & DCACHE_OP_REVALIDATE)) {
+		err = lower_dentry->d_op->d_revalidate(lower_dentry, flags);
+		if (err < 0)
+			return -ECHILD;
+		if (err == 0)
+			return 0;
+	}
+
+	if (parent_lower_dentry != ACCESS_ONCE(lower_dentry->d_parent))
+		return 0;
+
+	if (dentry < lower_dentry) {
+		spin_lock(&dentry->d_lock);
+		spin_lock_nested(&lower_dentry->d_lock, DENTRY_D_LOCK_NESTED);
+	} else {
+		spin_lock(&lower_dentry->d_lock);
+		spin_lock_nested(&dentry->d_lock, DENTRY_D_LOCK_NESTED);
+	}
+
+	if (d_unhashed(lower_dentry) ||
+	    !qstr_case_eq(&dentry->d_name, &lower_dentry->d_name))
+		err = 0;
+
+	if (dentry < lower_dentry) {
+		spin_unlock(&lower_dentry->d_lock);
+		spin_unlock(&dentry->d_lock);
+	} else {
+		spin_unlock(&dentry->d_lock);
+		spin_unlock(&lower_dentry->d_lock);
+	}
+	if (!err)
+		return 0;
+
+	/* If our top's inode is gone, we may be out of date */
+	inode = ACCESS_ONCE(dentry->d_inode);
+	if (inode) {
+		data = top_data_get(SDCARDFS_I(inode));
+		if (!data || data->abandoned)
+			err = 0;
+		if (data)
+			data_put(data);
+	}
+
+	return err;
+}
+
 /*
  * returns: -ERRNO if error (returned to user)
  *          0: tell VFS to invalidate dentry
@@ -38,7 +119,7 @@ static int sdcardfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 	struct sdcardfs_inode_data *data;
 
 	if (flags & LOOKUP_RCU)
-		return -ECHILD;
+		return sdcardfs_d_revalidate_rcu(dentry, flags);
 
 	spin_lock(&dentry->d_lock);
 	if (IS_ROOT(dentry)) {
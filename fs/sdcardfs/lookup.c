@@ -36,13 +36,30 @@ int sdcardfs_init_dentry_cache(void)
 
 void sdcardfs_destroy_dentry_cache(void)
 {
+	/* wait for free_dentry_private_data() callbacks in flight */
+	rcu_barrier();
 	kmem_cache_destroy(sdcardfs_dentry_cachep);
 }
 
+static void free_dentry_private_data_rcu(struct rcu_head *head)
+{
+	struct sdcardfs_dentry_info *info =
+		container_of(head, struct sdcardfs_dentry_info, rcu);
+
+	kmem_cache_free(sdcardfs_dentry_cachep, info);
+}
+
+/*
+ * The private data is freed after a grace period, since
+ * sdcardfs_d_revalidate() looks at it in RCU-walk mode without holding a
+ * reference to the dentry.
+ */
 void free_dentry_private_data(struct dentry *dentry)
 {
-	kmem_cache_free(sdcardfs_dentry_cachep, dentry->d_fsdata);
+	struct sdcardfs_dentry_info *info = dentry->d_fsdata;
+
 	dentry->d_fsdata = NULL;
+	call_rcu(&info->rcu, free_dentry_private_data_rcu);
 }
 
 /* allocate new dentry private data */
@@ -187,6 +187,7 @@ struct sdcardfs_dentry_info {
 	spinlock_t lock;	/* protects lower_path */
 	struct path lower_path;
 	struct path orig_path;
+	struct rcu_head rcu;	/* freed after RCU-walk revalidation */
 };
 
 struct sdcardfs_mount_options {
@@ -34,6 +34,7 @@ struct request;
 struct sg_io_hdr;
 struct bsg_job;
 struct blkcg_gq;
+struct rq_wb;
 
 #define BLKDEV_MIN_RQ	4
 #ifdef CONFIG_ZEN_INTERACTIVE
@@ -153,6 +154,10 @@ struct request {
 	struct request_list *rl;		/* rl this rq is alloced from */
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
+#endif
+#ifdef CONFIG_BLK_WBT
+	unsigned short wbt_flags;		/* writeback throttling state */
+	u64 wbt_issue_ns;			/* when passed to the driver */
 #endif
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
@@ -331,6 +336,11 @@ struct request_queue {
 
 	struct backing_dev_info	backing_dev_info;
 
+	/*
+	 * Buffered writeback throttling, see block/blk-wbt.c
+	 */
+	struct rq_wb		*rq_wb;
+
 	/*
 	 * The queue owner gets to use this for whatever they like.
 	 * ll_rw_blk doesn't touch it.
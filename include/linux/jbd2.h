@@ -265,7 +265,9 @@ typedef struct journal_superblock_s
 /* 0x0050 */
 	__u8	s_checksum_type;	/* checksum type */
 	__u8	s_padding2[3];
-	__u32	s_padding[42];
+	__u32	s_padding[41];
+/* 0x00F8 */
+	__be32	s_inode_fc_blks;	/* Inode fast commit blocks after s_maxlen */
 	__be32	s_checksum;		/* crc32c(superblock) */
 
 /* 0x0100 */
@@ -298,6 +300,9 @@ typedef struct journal_superblock_s
 					JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT | \
 					JBD2_FEATURE_INCOMPAT_CSUM_V2)
 
+/* Default number of blocks reserved at the end of the log for fast commits */
+#define JBD2_DEFAULT_FAST_COMMIT_BLOCKS	256
+
 #ifdef __KERNEL__
 
 #include <linux/fs.h>
@@ -683,6 +688,11 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_free: Journal free - how many free blocks are there in the journal?
  * @j_first: The block number of the first usable block
  * @j_last: The block number one beyond the last usable block
+ * @j_fc_first: The block number of the first fast commit block
+ * @j_fc_last: The block number one beyond the last fast commit block
+ * @j_fc_off: Number of fast commit blocks used by transaction @j_fc_tid
+ * @j_fc_tid: Transaction the fast commit area currently belongs to
+ * @j_fc_mutex: Serialises writers of the fast commit area
  * @j_dev: Device where we store the journal
  * @j_blocksize: blocksize for the location where we store the journal.
  * @j_blk_offset: starting block offset for into the device where we store the
@@ -721,6 +731,8 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_proc_entry: procfs entry for the jbd statistics directory
  * @j_stats: Overall statistics
  * @j_private: An opaque pointer to fs-private information.
+ * @j_fc_replay_callback: Client callback used to replay fast commit blocks
+ *  after the regular log has been recovered
  */
 
 struct journal_s
@@ -829,6 +841,22 @@ struct journal_s
 	unsigned long		j_first;
 	unsigned long		j_last;
 
+	/*
+	 * Fast commit area: the block numbers of the first block and one
+	 * beyond the last block reserved behind the log for fast commits.
+	 * Both are zero if the journal has no fast commit area.
+	 */
+	unsigned long		j_fc_first;
+	unsigned long		j_fc_last;
+
+	/*
+	 * Fast commit area usage: blocks used so far by transaction
+	 * j_fc_tid. [j_fc_mutex]
+	 */
+	unsigned long		j_fc_off;
+	tid_t			j_fc_tid;
+	struct mutex		j_fc_mutex;
+
 	/*
 	 * Device, blocksize and starting block offset for the location where we
 	 * store the journal.
@@ -942,6 +970,17 @@ struct journal_s
 	void			(*j_commit_callback)(journal_t *,
 						     transaction_t *);
 
+	/*
+	 * This function is called during recovery for each block of the fast
+	 * commit area, in order, after the log itself has been replayed.
+	 * @tid is the first transaction which did not make it to the log.
+	 * Return 0 to continue with the next block, a positive value to stop
+	 * replay or a negative error.
+	 */
+	int			(*j_fc_replay_callback)(journal_t *journal,
+							struct buffer_head *bh,
+							int off, tid_t tid);
+
 	/*
 	 * Journal statistics
 	 */
@@ -1126,6 +1165,11 @@ extern void	   jbd2_journal_ack_err    (journal_t *);
 extern int	   jbd2_journal_clear_err  (journal_t *);
 extern int	   jbd2_journal_bmap(journal_t *, unsigned long, unsigned long long *);
 extern int	   jbd2_journal_force_commit(journal_t *);
+extern int	   jbd2_fc_init(journal_t *, unsigned int);
+extern int	   jbd2_fc_begin_commit(journal_t *, tid_t);
+extern int	   jbd2_fc_get_buf(journal_t *, struct buffer_head **, int *);
+extern int	   jbd2_fc_submit_buf(journal_t *, struct buffer_head *);
+extern void	   jbd2_fc_end_commit(journal_t *);
 extern int	   jbd2_journal_file_inode(handle_t *handle, struct jbd2_inode *inode);
 extern int	   jbd2_journal_begin_ordered_truncate(journal_t *journal,
 				struct jbd2_inode *inode, loff_t new_size);
@@ -1210,6 +1254,11 @@ void __jbd2_log_wait_for_space(journal_t *journal);
 extern void __jbd2_journal_drop_transaction(journal_t *, transaction_t *);
 extern int jbd2_cleanup_journal_tail(journal_t *);
 
+static inline int jbd2_has_fast_commit(journal_t *journal)
+{
+	return journal->j_fc_last > journal->j_fc_first;
+}
+
 /* Debugging code only: */
 
 #define jbd_ENOSYS() \
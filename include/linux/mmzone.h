@@ -244,6 +244,13 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/*
+	 * Blocks of order 1..PAGE_ALLOC_COSTLY_ORDER, counted in blocks
+	 * rather than pages. Their batch and high marks derive from batch.
+	 */
+	int order_count[PAGE_ALLOC_COSTLY_ORDER];
+	struct list_head order_lists[PAGE_ALLOC_COSTLY_ORDER][MIGRATE_PCPTYPES];
 };
 
 struct per_cpu_pageset {
@@ -958,6 +958,44 @@ TRACE_EVENT(ext4_mballoc_prealloc,
 		  __entry->result_len, __entry->result_logical)
 );
 
+TRACE_EVENT(ext4_mballoc_regular_allocator,
+	TP_PROTO(struct ext4_allocation_context *ac, u64 delta_ns),
+
+	TP_ARGS(ac, delta_ns),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,	dev			)
+		__field(	ino_t,	ino			)
+		__field(	  int,	goal_len		)
+		__field(	__u32,	result_group		)
+		__field(	  int,	result_len		)
+		__field(	__u16,	groups			)
+		__field(	__u8,	cr			)
+		__field(	__u8,	status			)
+		__field(	u64,	delta_ns		)
+	),
+
+	TP_fast_assign(
+		__entry->dev		= ac->ac_inode->i_sb->s_dev;
+		__entry->ino		= ac->ac_inode->i_ino;
+		__entry->goal_len	= ac->ac_g_ex.fe_len;
+		__entry->result_group	= ac->ac_b_ex.fe_group;
+		__entry->result_len	= ac->ac_b_ex.fe_len;
+		__entry->groups		= ac->ac_groups_scanned;
+		__entry->cr		= ac->ac_criteria;
+		__entry->status		= ac->ac_status;
+		__entry->delta_ns	= delta_ns;
+	),
+
+	TP_printk("dev %d,%d inode %lu goal_len %d result %u/%d "
+		  "grps %u cr %u status %u took %llu ns",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  (unsigned long) __entry->ino, __entry->goal_len,
+		  __entry->result_group, __entry->result_len,
+		  __entry->groups, __entry->cr, __entry->status,
+		  (unsigned long long) __entry->delta_ns)
+);
+
 DECLARE_EVENT_CLASS(ext4__mballoc,
 	TP_PROTO(struct super_block *sb,
 		 struct inode *inode,
@@ -28,6 +28,38 @@ struct input_event {
 	__s32 value;
 };
 
+/*
+ * Memory-mapped event ring.  mmap() of an evdev file descriptor with
+ * MAP_SHARED and offset 0 switches that client from read() to a ring
+ * shared with the kernel.  The mapping starts with struct
+ * input_mmap_ring; @size slots of struct input_mmap_event follow at
+ * byte @offset.  @head and @tail are free-running counters, slot i
+ * lives at index i & (@size - 1).
+ *
+ * The kernel advances @head once per complete packet (SYN_REPORT)
+ * and wakes poll()ers.  The reader consumes slots up to @head and
+ * then stores the new @tail, with a full memory barrier between its
+ * last slot read and that store.  When the reader falls behind, the
+ * kernel drops events, counts them in @dropped and queues
+ * EV_SYN/SYN_DROPPED once there is room again.
+ */
+struct input_mmap_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 size;
+	__u32 dropped;
+	__u32 offset;
+};
+
+struct input_mmap_event {
+	__s64 sec;
+	__u32 usec;
+	__u16 type;
+	__u16 code;
+	__s32 value;
+	__u32 __reserved;
+};
+
 /*
  * Protocol version.
  */
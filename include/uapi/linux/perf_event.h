@@ -320,6 +320,12 @@ struct perf_event_attr {
 #define PERF_EVENT_IOC_SET_OUTPUT	_IO ('$', 5)
 #define PERF_EVENT_IOC_SET_FILTER	_IOW('$', 6, char *)
 
+/*
+ * Not an upstream ioctl; numbered well clear of upstream's sequential
+ * '$' range so a kernel without it answers -ENOTTY.
+ */
+#define PERF_EVENT_IOC_ADAPTIVE_WAKEUP	_IO ('$', 0x80)
+
 enum perf_event_ioc_flags {
 	PERF_IOC_FLAG_GROUP		= 1U << 0,
 };
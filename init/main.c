@@ -745,6 +745,7 @@ static char *initcall_level_names[] __initdata = {
 static void __init do_initcall_level(int level)
 {
 	extern const struct kernel_param __start___param[], __stop___param[];
+	ktime_t calltime;
 	initcall_t *fn;
 
 	strcpy(static_command_line, saved_command_line);
@@ -754,8 +755,19 @@ static void __init do_initcall_level(int level)
 		   level, level,
 		   &repair_env_string);
 
+	calltime = ktime_get();
 	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
 		do_one_initcall(*fn);
+
+	/*
+	 * Per-level totals for initcall_debug.  Async probes started by
+	 * this level are reported on their own "probe of" lines and are
+	 * only waited for before init memory is freed.
+	 */
+	if (initcall_debug)
+		pr_debug("initcall level %s took %lld msecs\n",
+			 initcall_level_names[level],
+			 ktime_to_ms(ktime_sub(ktime_get(), calltime)));
 }
 
 static void __init do_initcalls(void)
@@ -817,9 +829,15 @@ static noinline void __init kernel_init_freeable(void);
 
 static int __ref kernel_init(void *unused)
 {
+	ktime_t calltime;
+
 	kernel_init_freeable();
 	/* need to finish all async __init code before freeing the memory */
+	calltime = ktime_get();
 	async_synchronize_full();
+	if (initcall_debug)
+		pr_debug("waited %lld msecs for async probes and initcalls\n",
+			 ktime_to_ms(ktime_sub(ktime_get(), calltime)));
 	free_initmem();
 	mark_rodata_ro();
 	system_state = SYSTEM_RUNNING;
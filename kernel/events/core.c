@@ -3596,6 +3596,26 @@ static int perf_event_set_output(struct perf_event *event,
 				 struct perf_event *output_event);
 static int perf_event_set_filter(struct perf_event *event, void __user *arg);
 
+/*
+ * Adaptive wakeups act on the buffer itself, so only the event that
+ * is mmap()ed (rather than redirected with SET_OUTPUT) may flip them.
+ */
+static int perf_event_set_adaptive(struct perf_event *event, unsigned long arg)
+{
+	struct ring_buffer *rb;
+	int ret = -EINVAL;
+
+	mutex_lock(&event->mmap_mutex);
+	rb = event->rb;
+	if (rb && atomic_read(&event->mmap_count)) {
+		rb_set_adaptive(rb, !!arg);
+		ret = 0;
+	}
+	mutex_unlock(&event->mmap_mutex);
+
+	return ret;
+}
+
 static long _perf_ioctl(struct perf_event *event, unsigned int cmd, unsigned long arg)
 {
 	void (*func)(struct perf_event *);
@@ -3639,6 +3659,9 @@ static long _perf_ioctl(struct perf_event *event, unsigned int cmd, unsigned lon
 	case PERF_EVENT_IOC_SET_FILTER:
 		return perf_event_set_filter(event, (void __user *)arg);
 
+	case PERF_EVENT_IOC_ADAPTIVE_WAKEUP:
+		return perf_event_set_adaptive(event, arg);
+
 	default:
 		return -ENOTTY;
 	}
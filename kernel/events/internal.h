@@ -8,6 +8,14 @@
 
 #define RING_BUFFER_WRITABLE		0x01
 
+/*
+ * Adaptive wakeups: watermark crossings closer together than this
+ * double the watermark, ones further apart than
+ * RB_WAKEUP_RELAX_FACTOR times this halve it again.
+ */
+#define RB_WAKEUP_MIN_NS		(10 * NSEC_PER_MSEC)
+#define RB_WAKEUP_RELAX_FACTOR		8
+
 struct ring_buffer {
 	atomic_t			refcount;
 	struct rcu_head			rcu_head;
@@ -27,6 +35,10 @@ struct ring_buffer {
 	local_t				lost;		/* nr records lost   */
 
 	long				watermark;	/* wakeup watermark  */
+	int				adaptive;	/* scale watermark   */
+	long				watermark_min;
+	long				watermark_max;
+	u64				last_wakeup;	/* ns, adaptive only */
 	/* poll crap */
 	spinlock_t			event_lock;
 	struct list_head		event_list;
@@ -43,6 +55,7 @@ extern void rb_free(struct ring_buffer *rb);
 extern struct ring_buffer *
 rb_alloc(int nr_pages, long watermark, int cpu, int flags);
 extern void perf_event_wakeup(struct perf_event *event);
+extern void rb_set_adaptive(struct ring_buffer *rb, bool on);
 
 extern void
 perf_event_header__init_id(struct perf_event_header *header,
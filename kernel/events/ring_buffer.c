@@ -12,6 +12,7 @@
 #include <linux/perf_event.h>
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
+#include <linux/sched.h>
 
 #include "internal.h"
 
@@ -46,6 +47,56 @@ static bool perf_output_space(struct ring_buffer *rb, unsigned long tail,
 	return true;
 }
 
+/*
+ * With adaptive wakeups, a consumer that keeps being woken more often
+ * than every RB_WAKEUP_MIN_NS gets a larger watermark, up to 3/4 of
+ * the buffer, so continuous sampling costs fewer wakeups.  Once the
+ * rate drops the watermark shrinks back to what was asked for.
+ *
+ * Runs from the output path, possibly in NMI context; racing writers
+ * on other cpus can at worst skip or repeat one adjustment.
+ */
+static void rb_adapt_watermark(struct ring_buffer *rb)
+{
+	u64 now = local_clock();
+	u64 delta = now - rb->last_wakeup;
+	long watermark = rb->watermark;
+
+	rb->last_wakeup = now;
+
+	if (delta < RB_WAKEUP_MIN_NS) {
+		if (watermark * 2 <= rb->watermark_max)
+			rb->watermark = watermark * 2;
+	} else if (delta > RB_WAKEUP_MIN_NS * RB_WAKEUP_RELAX_FACTOR) {
+		if (watermark / 2 >= rb->watermark_min)
+			rb->watermark = watermark / 2;
+	}
+}
+
+/*
+ * Switch adaptive wakeups on or off for @rb; the caller holds the
+ * owning event's mmap_mutex.  Switching off puts back the watermark
+ * the buffer was created with.
+ */
+void rb_set_adaptive(struct ring_buffer *rb, bool on)
+{
+	if (on == !!rb->adaptive)
+		return;
+
+	if (on) {
+		rb->watermark_min = rb->watermark;
+		rb->watermark_max = max(rb->watermark,
+					(long)perf_data_size(rb) / 4 * 3);
+		rb->last_wakeup = local_clock();
+		smp_wmb();
+		rb->adaptive = 1;
+	} else {
+		rb->adaptive = 0;
+		smp_wmb();
+		rb->watermark = rb->watermark_min;
+	}
+}
+
 static void perf_output_wakeup(struct perf_output_handle *handle)
 {
 	atomic_set(&handle->rb->poll, POLL_IN);
@@ -186,8 +237,11 @@ int perf_output_begin(struct perf_output_handle *handle,
 			goto fail;
 	} while (local_cmpxchg(&rb->head, offset, head) != offset);
 
-	if (head - local_read(&rb->wakeup) > rb->watermark)
+	if (head - local_read(&rb->wakeup) > rb->watermark) {
 		local_add(rb->watermark, &rb->wakeup);
+		if (rb->adaptive)
+			rb_adapt_watermark(rb);
+	}
 
 	handle->page = offset >> (PAGE_SHIFT + page_order(rb));
 	handle->page &= rb->nr_pages - 1;
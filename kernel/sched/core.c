@@ -590,6 +590,7 @@ void resched_task(struct task_struct *p)
 		return;
 
 	set_tsk_need_resched(p);
+	sched_lat_resched(task_rq(p));
 
 	cpu = task_cpu(p);
 	if (cpu == smp_processor_id())
@@ -764,6 +765,7 @@ void resched_task(struct task_struct *p)
 {
 	assert_raw_spin_locked(&task_rq(p)->lock);
 	set_tsk_need_resched(p);
+	sched_lat_resched(task_rq(p));
 }
 #endif /* CONFIG_SMP */
 
@@ -3290,6 +3292,7 @@ need_resched:
 	put_prev_task(rq, prev);
 	next = pick_next_task(rq);
 	clear_tsk_need_resched(prev);
+	sched_lat_switch(rq, prev, next);
 	rq->skip_clock_update = 0;
 
 	if (likely(prev != next)) {
@@ -389,6 +389,24 @@ extern struct root_domain def_root_domain;
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+enum sched_lat_type {
+	SCHED_LAT_WAKEUP,	/* wakeup to first run */
+	SCHED_LAT_RUNQ,		/* preempted requeue to next run */
+	SCHED_LAT_PREEMPT,	/* resched request to context switch */
+	SCHED_LAT_NR
+};
+
+enum sched_lat_class {
+	SCHED_LAT_FAIR,
+	SCHED_LAT_RT,
+	SCHED_LAT_CLASSES
+};
+
+/* Bucket b > 0 holds [2^(b-1), 2^b) usecs, the last one is open */
+#define SCHED_LAT_BUCKETS	20
+#endif
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -506,6 +524,11 @@ struct rq {
 #ifdef CONFIG_SCHEDSTATS
 	/* latency stats */
 	struct sched_info rq_sched_info;
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	u64 resched_clock;	/* when curr was asked to reschedule */
+	unsigned int lat_hist[SCHED_LAT_NR][SCHED_LAT_CLASSES]
+			     [SCHED_LAT_BUCKETS];
+#endif
 	unsigned long long rq_cpu_time;
 	/* could above be rq->cfs_rq.exec_clock + rq->rt_rq.rt_runtime ? */
 
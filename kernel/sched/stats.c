@@ -137,9 +137,79 @@ static const struct file_operations proc_schedstat_operations = {
 	.release = seq_release,
 };
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+#define SCHEDLAT_VERSION 1
+
+static const char * const sched_lat_type_names[SCHED_LAT_NR] = {
+	[SCHED_LAT_WAKEUP]	= "wakeup",
+	[SCHED_LAT_RUNQ]	= "runq",
+	[SCHED_LAT_PREEMPT]	= "preempt",
+};
+
+static const char * const sched_lat_class_names[SCHED_LAT_CLASSES] = {
+	[SCHED_LAT_FAIR]	= "fair",
+	[SCHED_LAT_RT]		= "rt",
+};
+
+/*
+ * One line per cpu, latency type and class, each followed by
+ * SCHED_LAT_BUCKETS counts.  Bucket 0 is below 1us, bucket b covers
+ * [2^(b-1), 2^b) us and the last bucket everything above.
+ */
+static int show_schedlat(struct seq_file *seq, void *v)
+{
+	int cpu, type, class, b;
+	struct rq *rq;
+
+	if (v == (void *)1) {
+		seq_printf(seq, "version %d\n", SCHEDLAT_VERSION);
+		seq_printf(seq, "buckets %d\n", SCHED_LAT_BUCKETS);
+		return 0;
+	}
+
+	cpu = (unsigned long)(v - 2);
+	rq = cpu_rq(cpu);
+
+	for (type = 0; type < SCHED_LAT_NR; type++) {
+		for (class = 0; class < SCHED_LAT_CLASSES; class++) {
+			seq_printf(seq, "cpu%d %s %s", cpu,
+				   sched_lat_type_names[type],
+				   sched_lat_class_names[class]);
+			for (b = 0; b < SCHED_LAT_BUCKETS; b++)
+				seq_printf(seq, " %u",
+					   rq->lat_hist[type][class][b]);
+			seq_printf(seq, "\n");
+		}
+	}
+	return 0;
+}
+
+static const struct seq_operations schedlat_sops = {
+	.start = schedstat_start,
+	.next  = schedstat_next,
+	.stop  = schedstat_stop,
+	.show  = show_schedlat,
+};
+
+static int schedlat_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &schedlat_sops);
+}
+
+static const struct file_operations proc_schedlat_operations = {
+	.open    = schedlat_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = seq_release,
+};
+#endif /* CONFIG_SCHED_LATENCY_HIST */
+
 static int __init proc_schedstat_init(void)
 {
 	proc_create("schedstat", 0, NULL, &proc_schedstat_operations);
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	proc_create("schedlat", 0, NULL, &proc_schedlat_operations);
+#endif
 	return 0;
 }
 module_init(proc_schedstat_init);
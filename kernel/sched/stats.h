@@ -47,6 +47,73 @@ rq_sched_info_depart(struct rq *rq, unsigned long long delta)
 # define schedstat_set(var, val)	do { } while (0)
 #endif
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+/*
+ * Expects runqueue lock to be held for atomicity of update
+ */
+static inline void
+sched_lat_account(struct rq *rq, struct task_struct *p,
+		  enum sched_lat_type type, unsigned long long delta)
+{
+	unsigned int bucket = min_t(unsigned int, fls64(delta >> 10),
+				    SCHED_LAT_BUCKETS - 1);
+
+	rq->lat_hist[type][rt_task(p) ? SCHED_LAT_RT : SCHED_LAT_FAIR][bucket]++;
+}
+
+static inline void sched_lat_arrive(struct task_struct *t,
+				    unsigned long long delta)
+{
+	sched_lat_account(task_rq(t), t, t->sched_info.requeued ?
+			  SCHED_LAT_RUNQ : SCHED_LAT_WAKEUP, delta);
+}
+
+static inline void sched_lat_depart(struct task_struct *t)
+{
+	t->sched_info.requeued = t->state == TASK_RUNNING;
+}
+
+/*
+ * Called with rq->lock held whenever rq->curr is asked to reschedule;
+ * only the first request since the last switch starts the clock.
+ *
+ * rq->clock is no good here: check_preempt_curr() sets skip_clock_update,
+ * so the update_rq_clock() in __schedule() would leave it where it was
+ * when the reschedule was requested.  Read the cpu clock at both ends.
+ */
+static inline void sched_lat_resched(struct rq *rq)
+{
+	if (!rq->resched_clock)
+		rq->resched_clock = sched_clock_cpu(cpu_of(rq));
+}
+
+static inline void
+sched_lat_switch(struct rq *rq, struct task_struct *prev,
+		 struct task_struct *next)
+{
+	if (!rq->resched_clock)
+		return;
+	/* Waking an idle cpu is wakeup latency, not preemption */
+	if (prev != next && prev != rq->idle)
+		sched_lat_account(rq, prev, SCHED_LAT_PREEMPT,
+				  sched_clock_cpu(cpu_of(rq)) -
+				  rq->resched_clock);
+	rq->resched_clock = 0;
+}
+#else
+static inline void
+sched_lat_arrive(struct task_struct *t, unsigned long long delta)
+{}
+static inline void sched_lat_depart(struct task_struct *t)
+{}
+static inline void sched_lat_resched(struct rq *rq)
+{}
+static inline void
+sched_lat_switch(struct rq *rq, struct task_struct *prev,
+		 struct task_struct *next)
+{}
+#endif /* CONFIG_SCHED_LATENCY_HIST */
+
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 static inline void sched_info_reset_dequeued(struct task_struct *t)
 {
@@ -81,8 +148,10 @@ static void sched_info_arrive(struct task_struct *t)
 {
 	unsigned long long now = task_rq(t)->clock, delta = 0;
 
-	if (t->sched_info.last_queued)
+	if (t->sched_info.last_queued) {
 		delta = now - t->sched_info.last_queued;
+		sched_lat_arrive(t, delta);
+	}
 	sched_info_reset_dequeued(t);
 	t->sched_info.run_delay += delta;
 	t->sched_info.last_arrival = now;
@@ -116,6 +185,7 @@ static inline void sched_info_depart(struct task_struct *t)
 					t->sched_info.last_arrival;
 
 	rq_sched_info_depart(task_rq(t), delta);
+	sched_lat_depart(t);
 
 	if (t->state == TASK_RUNNING)
 		sched_info_queued(t);
@@ -173,6 +173,7 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 		P_ns(idle_exittime);
 		P_ns(idle_sleeptime);
 		P_ns(iowait_sleeptime);
+		P(idle_wakeups);
 		P(last_jiffies);
 		P(next_jiffies);
 		P_ns(idle_expires);
@@ -246,7 +247,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.7\n");
+	SEQ_printf(m, "Timer List Version: v0.8\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
@@ -1539,6 +1539,94 @@ tracing_generic_entry_update(struct trace_entry *entry, unsigned long flags,
 }
 EXPORT_SYMBOL_GPL(tracing_generic_entry_update);
 
+/*
+ * Events with a filter are first written to a per-cpu page and only
+ * copied into the ring buffer once the filter has accepted them, so
+ * rejected events never pay for a reservation and a discard. The
+ * counter guards against nesting: an interrupt tracing on top of a
+ * buffered event falls back to reserving directly in the ring buffer.
+ */
+DEFINE_PER_CPU(struct ring_buffer_event *, trace_buffered_event);
+DEFINE_PER_CPU(int, trace_buffered_event_cnt);
+static int trace_buffered_event_ref;
+
+/**
+ * trace_buffered_event_enable - enable buffering events
+ *
+ * Called when an event gets a filter. The first caller allocates the
+ * per-cpu pages. Must be called with event_mutex held.
+ */
+void trace_buffered_event_enable(void)
+{
+	struct ring_buffer_event *event;
+	struct page *page;
+	int cpu;
+
+	WARN_ON_ONCE(!mutex_is_locked(&event_mutex));
+
+	if (trace_buffered_event_ref++)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		page = alloc_pages_node(cpu_to_node(cpu),
+					GFP_KERNEL | __GFP_NORETRY, 0);
+		if (!page)
+			continue;
+
+		event = page_address(page);
+		memset(event, 0, sizeof(*event));
+		per_cpu(trace_buffered_event, cpu) = event;
+	}
+}
+
+static void enable_trace_buffered_event(void *data)
+{
+	/* Probably not needed, but do it anyway */
+	smp_rmb();
+	this_cpu_dec(trace_buffered_event_cnt);
+}
+
+static void disable_trace_buffered_event(void *data)
+{
+	this_cpu_inc(trace_buffered_event_cnt);
+}
+
+/**
+ * trace_buffered_event_disable - disable buffering events
+ *
+ * Called when an event loses its filter. The last caller frees the
+ * per-cpu pages. Must be called with event_mutex held.
+ */
+void trace_buffered_event_disable(void)
+{
+	int cpu;
+
+	WARN_ON_ONCE(!mutex_is_locked(&event_mutex));
+
+	if (WARN_ON_ONCE(!trace_buffered_event_ref))
+		return;
+
+	if (--trace_buffered_event_ref)
+		return;
+
+	/* Stop new users, then wait for the current ones to commit */
+	on_each_cpu(disable_trace_buffered_event, NULL, 1);
+	synchronize_sched();
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(trace_buffered_event, cpu))
+			free_page((unsigned long)per_cpu(trace_buffered_event,
+							 cpu));
+		per_cpu(trace_buffered_event, cpu) = NULL;
+	}
+	/*
+	 * Make sure trace_buffered_event is NULL before clearing
+	 * trace_buffered_event_cnt.
+	 */
+	smp_wmb();
+	on_each_cpu(enable_trace_buffered_event, NULL, 1);
+}
+
 struct ring_buffer_event *
 trace_buffer_lock_reserve(struct ring_buffer *buffer,
 			  int type,
@@ -1562,7 +1650,15 @@ void
 __buffer_unlock_commit(struct ring_buffer *buffer, struct ring_buffer_event *event)
 {
 	__this_cpu_write(trace_cmdline_save, true);
-	ring_buffer_unlock_commit(buffer, event);
+
+	/* If this is the temp buffer, we need to commit fully */
+	if (this_cpu_read(trace_buffered_event) == event) {
+		/* Length is in event->array[0] */
+		ring_buffer_write(buffer, event->array[0], &event->array[1]);
+		/* Release the temp buffer */
+		this_cpu_dec(trace_buffered_event_cnt);
+	} else
+		ring_buffer_unlock_commit(buffer, event);
 }
 
 static inline void
@@ -1590,7 +1686,27 @@ trace_event_buffer_lock_reserve(struct ring_buffer **current_rb,
 			  int type, unsigned long len,
 			  unsigned long flags, int pc)
 {
+	struct ring_buffer_event *entry;
+	int val;
+
 	*current_rb = ftrace_file->tr->trace_buffer.buffer;
+
+	if ((ftrace_file->event_call->flags & TRACE_EVENT_FL_FILTERED) &&
+	    (entry = this_cpu_read(trace_buffered_event))) {
+		/* Try to use the per cpu buffer first */
+		val = this_cpu_inc_return(trace_buffered_event_cnt);
+		if (val == 1 &&
+		    likely(len <= PAGE_SIZE - 2 * sizeof(entry->array[0]))) {
+			struct trace_entry *ent = (void *)&entry->array[1];
+
+			tracing_generic_entry_update(ent, flags, pc);
+			ent->type = type;
+			entry->array[0] = len;
+			return entry;
+		}
+		this_cpu_dec(trace_buffered_event_cnt);
+	}
+
 	return trace_buffer_lock_reserve(*current_rb,
 					 type, len, flags, pc);
 }
@@ -1630,7 +1746,7 @@ EXPORT_SYMBOL_GPL(trace_buffer_unlock_commit_regs);
 void trace_current_buffer_discard_commit(struct ring_buffer *buffer,
 					 struct ring_buffer_event *event)
 {
-	ring_buffer_discard_commit(buffer, event);
+	__trace_event_discard_commit(buffer, event);
 }
 EXPORT_SYMBOL_GPL(trace_current_buffer_discard_commit);
 
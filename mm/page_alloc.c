@@ -708,6 +708,83 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Small high-order blocks (task stacks, skb heads, slab pages) are
+ * cached per cpu as well. The batch halves with every order so each
+ * order's cache holds roughly as many pages as an order-0 batch.
+ */
+static inline int pcp_order_batch(struct per_cpu_pages *pcp,
+				  unsigned int order)
+{
+	return max(1, pcp->batch >> (order + 1));
+}
+
+static inline int pcp_order_high(struct per_cpu_pages *pcp,
+				 unsigned int order)
+{
+	return 2 * pcp_order_batch(pcp, order);
+}
+
+static inline struct list_head *pcp_order_list(struct per_cpu_pages *pcp,
+					       unsigned int order,
+					       int migratetype)
+{
+	return &pcp->order_lists[order - 1][migratetype];
+}
+
+static inline bool pcp_has_order_pages(struct per_cpu_pages *pcp)
+{
+	int i;
+
+	for (i = 0; i < PAGE_ALLOC_COSTLY_ORDER; i++)
+		if (pcp->order_count[i])
+			return true;
+	return false;
+}
+
+/*
+ * Frees up to count blocks of the given order from the PCP lists.
+ */
+static void free_pcppages_order_bulk(struct zone *zone, int count,
+				     struct per_cpu_pages *pcp,
+				     unsigned int order)
+{
+	int migratetype;
+
+	spin_lock(&zone->lock);
+	zone->pages_scanned = 0;
+
+	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++) {
+		struct list_head *list = pcp_order_list(pcp, order, migratetype);
+
+		while (count && !list_empty(list)) {
+			struct page *page;
+			int mt;
+
+			page = list_entry(list->prev, struct page, lru);
+			list_del(&page->lru);
+			mt = get_freepage_migratetype(page);
+			__free_one_page(page, zone, order, mt);
+			trace_mm_page_pcpu_drain(page, order, mt);
+			if (likely(!is_migrate_isolate_page(page)))
+				__mod_zone_freepage_state(zone, 1 << order, mt);
+			pcp->order_count[order - 1]--;
+			count--;
+		}
+	}
+	spin_unlock(&zone->lock);
+}
+
+static void drain_pcppages_order(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	unsigned int order;
+
+	for (order = 1; order <= PAGE_ALLOC_COSTLY_ORDER; order++)
+		if (pcp->order_count[order - 1])
+			free_pcppages_order_bulk(zone,
+					pcp->order_count[order - 1], pcp, order);
+}
+
 static void free_one_page(struct zone *zone, struct page *page, int order,
 				int migratetype)
 {
@@ -765,7 +842,24 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	__count_vm_events(PGFREE, 1 << order);
 	migratetype = get_pageblock_migratetype(page);
 	set_freepage_migratetype(page, migratetype);
-	free_one_page(page_zone(page), page, order, migratetype);
+
+	/*
+	 * ISOLATE, CMA and RESERVE blocks go straight back to the buddy,
+	 * and so does everything while the zone still uses boot_pageset
+	 * (high == 0), which all zones share and which must stay empty.
+	 */
+	if (order && order <= PAGE_ALLOC_COSTLY_ORDER &&
+	    migratetype < MIGRATE_PCPTYPES &&
+	    this_cpu_ptr(page_zone(page)->pageset)->pcp.high) {
+		struct zone *zone = page_zone(page);
+		struct per_cpu_pages *pcp = &this_cpu_ptr(zone->pageset)->pcp;
+
+		list_add(&page->lru, pcp_order_list(pcp, order, migratetype));
+		if (++pcp->order_count[order - 1] >= pcp_order_high(pcp, order))
+			free_pcppages_order_bulk(zone,
+					pcp_order_batch(pcp, order), pcp, order);
+	} else
+		free_one_page(page_zone(page), page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1313,6 +1407,7 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		drain_pcppages_order(zone, pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1356,7 +1451,7 @@ void drain_all_pages(void)
 		bool has_pcps = false;
 		for_each_populated_zone(zone) {
 			pcp = per_cpu_ptr(zone->pageset, cpu);
-			if (pcp->pcp.count) {
+			if (pcp->pcp.count || pcp_has_order_pages(&pcp->pcp)) {
 				has_pcps = true;
 				break;
 			}
@@ -1564,6 +1659,44 @@ int split_free_page(struct page *page)
 	return nr_pages;
 }
 
+/*
+ * Takes a block of 0 < order <= PAGE_ALLOC_COSTLY_ORDER from the PCP
+ * lists, refilling them from the buddy allocator if needed. Called with
+ * interrupts disabled.
+ */
+static struct page *rmqueue_pcp_order(struct zone *zone, unsigned int order,
+				      int migratetype, int cold)
+{
+	struct per_cpu_pages *pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	struct list_head *list = pcp_order_list(pcp, order, migratetype);
+	struct page *page;
+
+	/* boot_pageset is shared by all zones, never cache blocks on it */
+	if (unlikely(!pcp->high)) {
+		spin_lock(&zone->lock);
+		page = __rmqueue(zone, order, migratetype);
+		spin_unlock(&zone->lock);
+		if (page)
+			__mod_zone_freepage_state(zone, -(1 << order),
+					get_freepage_migratetype(page));
+		return page;
+	}
+
+	if (list_empty(list)) {
+		pcp->order_count[order - 1] += rmqueue_bulk(zone, order,
+					pcp_order_batch(pcp, order), list,
+					migratetype, cold, 0);
+		if (unlikely(list_empty(list)))
+			return NULL;
+	}
+
+	page = list_entry(list->next, struct page, lru);
+	list_del(&page->lru);
+	pcp->order_count[order - 1]--;
+
+	return page;
+}
+
 /*
  * Really, prep_compound_page() should be called from __rmqueue_bulk().  But
  * we cheat by calling it from here, in the order > 0 path.  Saves a branch
@@ -1616,16 +1749,24 @@ again:
 			 */
 			WARN_ON_ONCE(order > 1);
 		}
-		spin_lock_irqsave(&zone->lock, flags);
-		if (gfp_flags & __GFP_CMA)
-			page = __rmqueue_cma(zone, order, migratetype);
-		else
-			page = __rmqueue(zone, order, migratetype);
-		spin_unlock(&zone->lock);
-		if (!page)
-			goto failed;
-		__mod_zone_freepage_state(zone, -(1 << order),
-					  get_freepage_migratetype(page));
+		if (order <= PAGE_ALLOC_COSTLY_ORDER &&
+		    !(gfp_flags & __GFP_CMA)) {
+			local_irq_save(flags);
+			page = rmqueue_pcp_order(zone, order, migratetype, cold);
+			if (!page)
+				goto failed;
+		} else {
+			spin_lock_irqsave(&zone->lock, flags);
+			if (gfp_flags & __GFP_CMA)
+				page = __rmqueue_cma(zone, order, migratetype);
+			else
+				page = __rmqueue(zone, order, migratetype);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			__mod_zone_freepage_state(zone, -(1 << order),
+						  get_freepage_migratetype(page));
+		}
 	}
 
 	__count_zone_vm_events(PGALLOC, zone, 1 << order);
@@ -4171,7 +4312,7 @@ static int __meminit zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -4181,6 +4322,10 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+	for (order = 0; order < PAGE_ALLOC_COSTLY_ORDER; order++)
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++)
+			INIT_LIST_HEAD(&pcp->order_lists[order][migratetype]);
 }
 
 /*
@@ -6214,6 +6359,7 @@ static int __meminit __zone_pcp_update(void *data)
 		local_irq_save(flags);
 		if (pcp->count > 0)
 			free_pcppages_bulk(zone, pcp->count, pcp);
+		drain_pcppages_order(zone, pcp);
 		drain_zonestat(zone, pset);
 		setup_pageset(pset, batch);
 		local_irq_restore(flags);
@@ -2634,6 +2634,105 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/*
+ * Bulk free: objects that belong to the current cpu slab are chained
+ * onto its freelist with interrupts disabled and a single tid bump,
+ * everything else takes the regular slab_free() path.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	struct kmem_cache_cpu *c;
+	struct page *page;
+	size_t i;
+
+	local_irq_disable();
+	c = __this_cpu_ptr(s->cpu_slab);
+
+	for (i = 0; i < size; i++) {
+		void *object = p[i];
+		struct kmem_cache *cachep = cache_from_obj(s, object);
+
+		if (unlikely(!cachep))
+			continue;
+
+		page = virt_to_head_page(object);
+
+		if (likely(cachep == s && page == c->page)) {
+			/* Fastpath: local cpu slab free */
+			slab_free_hook(s, object);
+			set_freepointer(s, object, c->freelist);
+			c->freelist = object;
+			stat(s, FREE_FASTPATH);
+		} else {
+			c->tid = next_tid(c->tid);
+			local_irq_enable();
+			slab_free(cachep, page, object, _RET_IP_);
+			local_irq_disable();
+			c = __this_cpu_ptr(s->cpu_slab);
+		}
+		trace_kmem_cache_free(_RET_IP_, object);
+	}
+	c->tid = next_tid(c->tid);
+	local_irq_enable();
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
+/*
+ * Bulk alloc: drains the current cpu freelist with interrupts disabled
+ * and a single tid bump, then falls back to single object allocation.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+								void **p)
+{
+	struct kmem_cache_cpu *c;
+	size_t i, j;
+
+	/* Debugging fallback to generic bulk */
+	if (kmem_cache_debug(s))
+		return __kmem_cache_alloc_bulk(s, flags, size, p);
+
+	if (slab_pre_alloc_hook(s, flags))
+		return 0;
+
+	s = memcg_kmem_get_cache(s, flags);
+
+	local_irq_disable();
+	c = __this_cpu_ptr(s->cpu_slab);
+
+	for (i = 0; i < size; i++) {
+		void *object = c->freelist;
+
+		if (!object)
+			break;
+
+		c->freelist = get_freepointer(s, object);
+		p[i] = object;
+		stat(s, ALLOC_FASTPATH);
+	}
+	c->tid = next_tid(c->tid);
+	local_irq_enable();
+
+	/* Clear memory and run hooks outside the irq disabled loop */
+	for (j = 0; j < i; j++) {
+		if (unlikely(flags & __GFP_ZERO))
+			memset(p[j], 0, s->object_size);
+		slab_post_alloc_hook(s, flags, p[j]);
+	}
+
+	/* Fallback to single object allocation */
+	for (; i < size; i++) {
+		void *x = p[i] = kmem_cache_alloc(s, flags);
+
+		if (unlikely(!x)) {
+			kmem_cache_free_bulk(s, i, p);
+			return 0;
+		}
+	}
+
+	return i;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
 /*
  * Object placement in a slab is made very easy because we always start at
  * offset 0. If we tune the size of the object to the alignment then we can
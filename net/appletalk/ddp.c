@@ -1575,7 +1575,7 @@ static int atalk_sendmsg(struct kiocb *iocb, struct socket *sock, struct msghdr
 	struct atalk_route *rt;
 	int err;
 
-	if (flags & ~(MSG_DONTWAIT|MSG_CMSG_COMPAT))
+	if (flags & ~(MSG_DONTWAIT|MSG_CMSG_COMPAT|MSG_BATCH))
 		return -EINVAL;
 
 	if (len > DDP_MAXSZ)
@@ -593,6 +593,58 @@ void __kfree_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(__kfree_skb);
 
+#define SKB_FREE_BULK_SIZE	32
+
+struct skb_free_cache {
+	size_t count;
+	void *heads[SKB_FREE_BULK_SIZE];
+};
+
+static DEFINE_PER_CPU(struct skb_free_cache, skb_free_cache);
+
+/**
+ *	__kfree_skb_flush - return deferred sk_buff heads to the slab
+ *
+ *	Must be called from softirq context, after a run of
+ *	__kfree_skb_defer().
+ */
+void __kfree_skb_flush(void)
+{
+	struct skb_free_cache *fc = &__get_cpu_var(skb_free_cache);
+
+	if (fc->count) {
+		kmem_cache_free_bulk(skbuff_head_cache, fc->count, fc->heads);
+		fc->count = 0;
+	}
+}
+
+/**
+ *	__kfree_skb_defer - free an sk_buff, batching the head free
+ *	@skb: buffer
+ *
+ *	Like __kfree_skb(), but the sk_buff head itself is collected and
+ *	returned to skbuff_head_cache in bulk, either once the batch is
+ *	full or by __kfree_skb_flush(). Softirq context only.
+ */
+void __kfree_skb_defer(struct sk_buff *skb)
+{
+	struct skb_free_cache *fc;
+
+	if (skb->fclone != SKB_FCLONE_UNAVAILABLE) {
+		__kfree_skb(skb);
+		return;
+	}
+
+	skb_release_all(skb);
+
+	fc = &__get_cpu_var(skb_free_cache);
+	fc->heads[fc->count++] = skb;
+	if (unlikely(fc->count == SKB_FREE_BULK_SIZE)) {
+		kmem_cache_free_bulk(skbuff_head_cache, fc->count, fc->heads);
+		fc->count = 0;
+	}
+}
+
 /**
  *	kfree_skb - free an sk_buff
  *	@skb: buffer to free
@@ -1770,15 +1822,46 @@ static bool __skb_splice_bits(struct sk_buff *skb, struct pipe_inode_info *pipe,
 	return false;
 }
 
+ssize_t skb_socket_splice(struct sock *sk,
+			  struct pipe_inode_info *pipe,
+			  struct splice_pipe_desc *spd)
+{
+	int ret;
+
+	/*
+	 * Drop the socket lock, otherwise we have reverse
+	 * locking dependencies between sk_lock and i_mutex
+	 * here as compared to sendfile(). We enter here
+	 * with the socket lock held, and splice_to_pipe() will
+	 * grab the pipe inode lock. For sendfile() emulation,
+	 * we call into ->sendpage() with the i_mutex lock held
+	 * and networking will grab the socket lock.
+	 */
+	release_sock(sk);
+	ret = splice_to_pipe(pipe, spd);
+	lock_sock(sk);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(skb_socket_splice);
+
 /*
  * Map data from the skb to a pipe. Should handle both the linear part,
  * the fragments, and the frag list. It does NOT handle frag lists within
  * the frag list, if such a thing exists. We'd probably need to recurse to
  * handle that cleanly.
+ *
+ * @sk is the socket the data is being read from, which is not necessarily
+ * skb->sk (AF_UNIX skbs are owned by the sender). @splice_cb is called to
+ * move the collected pages into the pipe with whatever locking the caller
+ * needs around splice_to_pipe().
  */
-int skb_splice_bits(struct sk_buff *skb, unsigned int offset,
+int skb_splice_bits(struct sk_buff *skb, struct sock *sk, unsigned int offset,
 		    struct pipe_inode_info *pipe, unsigned int tlen,
-		    unsigned int flags)
+		    unsigned int flags,
+		    ssize_t (*splice_cb)(struct sock *,
+					 struct pipe_inode_info *,
+					 struct splice_pipe_desc *))
 {
 	struct partial_page partial[MAX_SKB_FRAGS];
 	struct page *pages[MAX_SKB_FRAGS];
@@ -1791,7 +1874,6 @@ int skb_splice_bits(struct sk_buff *skb, unsigned int offset,
 		.spd_release = sock_spd_release,
 	};
 	struct sk_buff *frag_iter;
-	struct sock *sk = skb->sk;
 	int ret = 0;
 
 	/*
@@ -1814,23 +1896,12 @@ int skb_splice_bits(struct sk_buff *skb, unsigned int offset,
 	}
 
 done:
-	if (spd.nr_pages) {
-		/*
-		 * Drop the socket lock, otherwise we have reverse
-		 * locking dependencies between sk_lock and i_mutex
-		 * here as compared to sendfile(). We enter here
-		 * with the socket lock held, and splice_to_pipe() will
-		 * grab the pipe inode lock. For sendfile() emulation,
-		 * we call into ->sendpage() with the i_mutex lock held
-		 * and networking will grab the socket lock.
-		 */
-		release_sock(sk);
-		ret = splice_to_pipe(pipe, &spd);
-		lock_sock(sk);
-	}
+	if (spd.nr_pages)
+		ret = splice_cb(sk, pipe, &spd);
 
 	return ret;
 }
+EXPORT_SYMBOL_GPL(skb_splice_bits);
 
 /**
  *	skb_store_bits - store bits from kernel buffer to skb
@@ -91,7 +91,7 @@ static int pn_sendmsg(struct kiocb *iocb, struct sock *sk,
 	int err;
 
 	if (msg->msg_flags & ~(MSG_DONTWAIT|MSG_EOR|MSG_NOSIGNAL|
-				MSG_CMSG_COMPAT))
+				MSG_CMSG_COMPAT|MSG_BATCH))
 		return -EOPNOTSUPP;
 
 	if (msg->msg_name == NULL)
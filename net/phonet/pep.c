@@ -1133,7 +1133,7 @@ static int pep_sendmsg(struct kiocb *iocb, struct sock *sk,
 		return -EMSGSIZE;
 
 	if ((msg->msg_flags & ~(MSG_DONTWAIT|MSG_EOR|MSG_NOSIGNAL|
-				MSG_CMSG_COMPAT)) ||
+				MSG_CMSG_COMPAT|MSG_BATCH)) ||
 			!(msg->msg_flags & MSG_EOR))
 		return -EOPNOTSUPP;
 
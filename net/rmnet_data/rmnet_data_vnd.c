@@ -16,11 +16,15 @@
  */
 
 #include <linux/types.h>
+#include <linux/module.h>
 #include <linux/rmnet_data.h>
 #include <linux/msm_rmnet.h>
 #include <linux/etherdevice.h>
 #include <linux/if_arp.h>
 #include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include <net/pkt_sched.h>
 #include <linux/atomic.h>
 #include <linux/net_map.h>
@@ -37,6 +41,7 @@ RMNET_LOG_MODULE(RMNET_DATA_LOGMASK_VND);
 #define RMNET_MAP_FLOW_NUM_TC_HANDLE 3
 #define RMNET_VND_UF_ACTION_ADD 0
 #define RMNET_VND_UF_ACTION_DEL 1
+#define RMNET_VND_MAX_RFS_FLOWS 32768
 enum {
 	RMNET_VND_UPDATE_FLOW_OK,
 	RMNET_VND_UPDATE_FLOW_NO_ACTION,
@@ -46,6 +51,17 @@ enum {
 
 struct net_device *rmnet_devices[RMNET_DATA_MAX_VND];
 
+#ifdef CONFIG_RPS
+static unsigned int rmnet_data_rps_cpus;
+module_param(rmnet_data_rps_cpus, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rmnet_data_rps_cpus, "Default RPS cpu mask for new VNDs");
+
+static unsigned int rmnet_data_rfs_flow_cnt;
+module_param(rmnet_data_rfs_flow_cnt, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rmnet_data_rfs_flow_cnt,
+		 "Default RFS flow table size for new VNDs");
+#endif
+
 struct rmnet_map_flow_mapping_s {
 	struct list_head list;
 	uint32_t map_flow_id;
@@ -536,6 +552,69 @@ int rmnet_vnd_init(void)
 	return 0;
 }
 
+#ifdef CONFIG_RPS
+/**
+ * rmnet_vnd_set_rps() - Install default receive steering on a new VND
+ * @dev:        Freshly registered virtual network device
+ *
+ * The physical device only sees MAP aggregates, so its flow hash is
+ * useless for RPS. The VNDs are the first devices that see individual
+ * flows, and steering there spreads GRO, netfilter and qtaguid work
+ * away from the CPU taking the IPA/BAM interrupt. The map and flow
+ * table are released together with the rx queue, the same way as
+ * ones written through sysfs, which can still override these values.
+ */
+static void rmnet_vnd_set_rps(struct net_device *dev)
+{
+	struct netdev_rx_queue *queue = dev->_rx;
+	struct rps_dev_flow_table *table;
+	struct rps_map *map;
+	unsigned int cpu, i = 0, cnt = 0, nr_cpus = 0;
+
+	if (rmnet_data_rps_cpus) {
+		map = kzalloc(max_t(unsigned int, RPS_MAP_SIZE(nr_cpu_ids),
+				    L1_CACHE_BYTES), GFP_KERNEL);
+		if (!map)
+			return;
+
+		for_each_online_cpu(cpu)
+			if (cpu < 32 && (rmnet_data_rps_cpus & (1U << cpu)))
+				map->cpus[i++] = cpu;
+
+		if (!i) {
+			kfree(map);
+			return;
+		}
+		map->len = nr_cpus = i;
+		rcu_assign_pointer(queue->rps_map, map);
+		static_key_slow_inc(&rps_needed);
+	}
+
+	if (rmnet_data_rfs_flow_cnt) {
+		cnt = roundup_pow_of_two(min_t(unsigned int,
+					       rmnet_data_rfs_flow_cnt,
+					       RMNET_VND_MAX_RFS_FLOWS));
+		table = vmalloc(RPS_DEV_FLOW_TABLE_SIZE(cnt));
+		if (table) {
+			table->mask = cnt - 1;
+			for (i = 0; i < cnt; i++)
+				table->flows[i].cpu = RPS_NO_CPU;
+			rcu_assign_pointer(queue->rps_flow_table, table);
+		} else {
+			cnt = 0;
+		}
+	}
+
+	if (nr_cpus || cnt)
+		LOGM("RPS on %u cpus, %u RFS flows on %s", nr_cpus, cnt,
+		     dev->name);
+}
+#else
+static inline void rmnet_vnd_set_rps(struct net_device *dev)
+{
+}
+#endif /* CONFIG_RPS */
+
 /**
  * rmnet_vnd_create_dev() - Create a new virtual network device node.
  * @id:         Virtual device node id
@@ -602,6 +681,7 @@ int rmnet_vnd_create_dev(int id, struct net_device **new_device,
 	} else {
 		rmnet_devices[id] = dev;
 		*new_device = dev;
+		rmnet_vnd_set_rps(dev);
 	}
 
 	LOGM("Registered device %s", dev->name);
@@ -2159,7 +2159,12 @@ int __sys_sendmmsg(int fd, struct mmsghdr __user *mmsg, unsigned int vlen,
 	compat_entry = (struct compat_mmsghdr __user *)mmsg;
 	err = 0;
 
+	flags |= MSG_BATCH;
+
 	while (datagrams < vlen) {
+		if (datagrams == vlen - 1)
+			flags &= ~MSG_BATCH;
+
 		if (MSG_CMSG_COMPAT & flags) {
 			err = ___sys_sendmsg(sock, (struct msghdr __user *)compat_entry,
 					     &msg_sys, flags, &used_address);
@@ -1089,7 +1089,8 @@ static int x25_sendmsg(struct kiocb *iocb, struct socket *sock,
 	int qbit = 0, rc = -EINVAL;
 
 	lock_sock(sk);
-	if (msg->msg_flags & ~(MSG_DONTWAIT|MSG_OOB|MSG_EOR|MSG_CMSG_COMPAT))
+	if (msg->msg_flags & ~(MSG_DONTWAIT|MSG_OOB|MSG_EOR|MSG_CMSG_COMPAT|
+			       MSG_BATCH))
 		goto out;
 
 	/* we currently don't support segmented records at the user interface */
@@ -29,6 +29,11 @@
 #include <linux/ip.h>
 #include <linux/audit.h>
 #include <linux/ipv6.h>
+#include <linux/jhash.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/log2.h>
 #include <net/ipv6.h>
 #include "avc.h"
 #include "avc_ss.h"
@@ -38,6 +43,13 @@
 #define AVC_DEF_CACHE_THRESHOLD		512
 #define AVC_CACHE_RECLAIM		16
 
+/*
+ * The cache grows, up to these limits, when the working set does not
+ * fit: see avc_check_thrash().
+ */
+#define AVC_CACHE_MAX_SLOTS		8192
+#define AVC_CACHE_MAX_THRESHOLD		8192
+
 #ifdef CONFIG_SECURITY_SELINUX_AVC_STATS
 #define avc_cache_stats_incr(field)	this_cpu_inc(avc_cache_stats.field)
 #else
@@ -68,12 +80,24 @@ struct avc_xperms_node {
 	struct list_head xpd_head; /* list head of extended_perms_decision */
 };
 
+struct avc_slot {
+	struct hlist_head	head;	/* head for avc_node->list */
+	spinlock_t		lock;	/* lock for writes */
+};
+
+struct avc_slots {
+	unsigned int		size;	/* power of two */
+	struct avc_slot		slot[0];
+};
+
 struct avc_cache {
-	struct hlist_head	slots[AVC_CACHE_SLOTS]; /* head for avc_node->list */
-	spinlock_t		slots_lock[AVC_CACHE_SLOTS]; /* lock for writes */
+	struct avc_slots __rcu	*table;
 	atomic_t		lru_hint;	/* LRU hint for reclaim scan */
 	atomic_t		active_nodes;
 	u32			latest_notif;	/* latest revocation notification */
+	atomic_t		reclaimed;	/* reclaims since reclaim_start */
+	unsigned long		reclaim_start;
+	unsigned int		resizes;
 };
 
 struct avc_callback_node {
@@ -85,6 +109,9 @@ struct avc_callback_node {
 /* Exported via selinufs */
 unsigned int avc_cache_threshold = AVC_DEF_CACHE_THRESHOLD;
 
+/* set once userspace picks a threshold; stops automatic growth */
+static bool avc_threshold_pinned;
+
 #ifdef CONFIG_SECURITY_SELINUX_AVC_STATS
 DEFINE_PER_CPU(struct avc_cache_stats, avc_cache_stats) = { 0 };
 #endif
@@ -96,9 +123,56 @@ static struct kmem_cache *avc_xperms_data_cachep;
 static struct kmem_cache *avc_xperms_decision_cachep;
 static struct kmem_cache *avc_xperms_cachep;
 
-static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
+static void avc_resize_work_fn(struct work_struct *work);
+static DECLARE_WORK(avc_resize_work, avc_resize_work_fn);
+static DEFINE_MUTEX(avc_resize_mutex);
+
+/*
+ * SIDs are small sequential integers, and the old xor/shift mix put
+ * related domain/type pairs into the same few buckets; jhash spreads
+ * them over the whole table.
+ */
+static inline struct avc_slot *avc_hash(struct avc_slots *table,
+					u32 ssid, u32 tsid, u16 tclass)
+{
+	return &table->slot[jhash_3words(ssid, tsid, tclass, 0) &
+			    (table->size - 1)];
+}
+
+static inline struct avc_slots *avc_table(void)
+{
+	return rcu_dereference(avc_cache.table);
+}
+
+static struct avc_slots *avc_alloc_slots(unsigned int size, gfp_t gfp)
+{
+	struct avc_slots *table;
+	size_t bytes = sizeof(*table) + size * sizeof(struct avc_slot);
+	unsigned int i;
+
+	if (bytes <= PAGE_SIZE << PAGE_ALLOC_COSTLY_ORDER)
+		table = kzalloc(bytes, gfp | __GFP_NOWARN);
+	else
+		table = NULL;
+	if (!table && (gfp & __GFP_WAIT))
+		table = vzalloc(bytes);
+	if (!table)
+		return NULL;
+
+	table->size = size;
+	for (i = 0; i < size; i++) {
+		INIT_HLIST_HEAD(&table->slot[i].head);
+		spin_lock_init(&table->slot[i].lock);
+	}
+	return table;
+}
+
+static void avc_free_slots(struct avc_slots *table)
 {
-	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
+	if (is_vmalloc_addr(table))
+		vfree(table);
+	else
+		kfree(table);
 }
 
 /**
@@ -175,14 +249,16 @@ static void avc_dump_query(struct audit_buffer *ab, u32 ssid, u32 tsid, u16 tcla
  */
 void __init avc_init(void)
 {
-	int i;
+	struct avc_slots *table;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-		INIT_HLIST_HEAD(&avc_cache.slots[i]);
-		spin_lock_init(&avc_cache.slots_lock[i]);
-	}
+	table = avc_alloc_slots(AVC_CACHE_SLOTS, GFP_KERNEL);
+	if (!table)
+		panic("SELinux: unable to allocate the AVC\n");
+	RCU_INIT_POINTER(avc_cache.table, table);
 	atomic_set(&avc_cache.active_nodes, 0);
 	atomic_set(&avc_cache.lru_hint, 0);
+	atomic_set(&avc_cache.reclaimed, 0);
+	avc_cache.reclaim_start = jiffies;
 
 	avc_node_cachep = kmem_cache_create("avc_node", sizeof(struct avc_node),
 					0, SLAB_PANIC, NULL);
@@ -202,16 +278,19 @@ void __init avc_init(void)
 
 int avc_get_hash_stats(char *page)
 {
-	int i, chain_len, max_chain_len, slots_used;
+	int i, chain_len, max_chain_len, slots_used, size;
+	struct avc_slots *table;
 	struct avc_node *node;
 	struct hlist_head *head;
 
 	rcu_read_lock();
 
+	table = avc_table();
+	size = table->size;
 	slots_used = 0;
 	max_chain_len = 0;
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-		head = &avc_cache.slots[i];
+	for (i = 0; i < size; i++) {
+		head = &table->slot[i].head;
 		if (!hlist_empty(head)) {
 			slots_used++;
 			chain_len = 0;
@@ -225,9 +304,9 @@ int avc_get_hash_stats(char *page)
 	rcu_read_unlock();
 
 	return scnprintf(page, PAGE_SIZE, "entries: %d\nbuckets used: %d/%d\n"
-			 "longest chain: %d\n",
+			 "longest chain: %d\nresizes: %u\n",
 			 atomic_read(&avc_cache.active_nodes),
-			 slots_used, AVC_CACHE_SLOTS, max_chain_len);
+			 slots_used, size, max_chain_len, avc_cache.resizes);
 }
 
 /*
@@ -513,16 +592,17 @@ static void avc_node_replace(struct avc_node *new, struct avc_node *old)
 
 static inline int avc_reclaim_node(void)
 {
+	struct avc_slots *table = avc_table();
 	struct avc_node *node;
 	int hvalue, try, ecx;
 	unsigned long flags;
 	struct hlist_head *head;
 	spinlock_t *lock;
 
-	for (try = 0, ecx = 0; try < AVC_CACHE_SLOTS; try++) {
-		hvalue = atomic_inc_return(&avc_cache.lru_hint) & (AVC_CACHE_SLOTS - 1);
-		head = &avc_cache.slots[hvalue];
-		lock = &avc_cache.slots_lock[hvalue];
+	for (try = 0, ecx = 0; try < table->size; try++) {
+		hvalue = atomic_inc_return(&avc_cache.lru_hint) & (table->size - 1);
+		head = &table->slot[hvalue].head;
+		lock = &table->slot[hvalue].lock;
 
 		if (!spin_trylock_irqsave(lock, flags))
 			continue;
@@ -545,6 +625,112 @@ out:
 	return ecx;
 }
 
+/*
+ * Reclaiming a whole cache's worth of entries within a second means
+ * the working set does not fit in the cache, so we keep evicting
+ * entries that are about to be looked up again.  Grow the cache.
+ */
+static void avc_check_thrash(int reclaimed)
+{
+	unsigned long start = avc_cache.reclaim_start;
+
+	if (atomic_add_return(reclaimed, &avc_cache.reclaimed) <
+	    avc_cache_threshold)
+		return;
+
+	atomic_set(&avc_cache.reclaimed, 0);
+	avc_cache.reclaim_start = jiffies;
+
+	if (time_before(jiffies, start + HZ) && !avc_threshold_pinned &&
+	    avc_cache_threshold < AVC_CACHE_MAX_THRESHOLD)
+		schedule_work(&avc_resize_work);
+}
+
+static inline struct avc_slots *avc_table_locked(void)
+{
+	return rcu_dereference_protected(avc_cache.table,
+					 lockdep_is_held(&avc_resize_mutex));
+}
+
+/*
+ * Swap in an empty table of @size slots.  Nodes can't be moved between
+ * RCU hash chains under concurrent lookups, so the cached entries are
+ * dropped and the working set is refilled on demand.
+ */
+static int avc_replace_table(unsigned int size)
+{
+	struct avc_slots *old, *new;
+	struct avc_node *node;
+	struct hlist_node *tmp;
+	unsigned int i;
+
+	new = avc_alloc_slots(size, GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+
+	old = avc_table_locked();
+	rcu_assign_pointer(avc_cache.table, new);
+
+	/*
+	 * Lookups and updates run under rcu_read_lock(), so once a grace
+	 * period has passed nobody can reach the old table any more.
+	 */
+	synchronize_rcu();
+
+	for (i = 0; i < old->size; i++) {
+		hlist_for_each_entry_safe(node, tmp, &old->slot[i].head, list) {
+			hlist_del(&node->list);
+			avc_node_kill(node);
+		}
+	}
+	avc_free_slots(old);
+	return 0;
+}
+
+/*
+ * Double the threshold, and the table along with it.  A threshold set
+ * through selinuxfs is left alone.
+ */
+static void avc_resize_work_fn(struct work_struct *work)
+{
+	unsigned int threshold, size;
+
+	mutex_lock(&avc_resize_mutex);
+	if (avc_threshold_pinned)
+		goto out;
+
+	threshold = min_t(unsigned int, avc_cache_threshold * 2,
+			  AVC_CACHE_MAX_THRESHOLD);
+	size = min_t(unsigned int, roundup_pow_of_two(threshold),
+		     AVC_CACHE_MAX_SLOTS);
+
+	if (size <= avc_table_locked()->size) {
+		avc_cache_threshold = threshold;
+		goto out;
+	}
+	if (avc_replace_table(size))
+		goto out;
+
+	avc_cache_threshold = threshold;
+	avc_cache.resizes++;
+	printk(KERN_INFO "SELinux: avc:  cache grown to %u entries, %u slots\n",
+	       threshold, size);
+out:
+	mutex_unlock(&avc_resize_mutex);
+}
+
+/*
+ * Called from selinuxfs.  The admin's value sticks: the cache no
+ * longer grows on its own once it has been set.
+ */
+void avc_set_cache_threshold(unsigned int threshold)
+{
+	mutex_lock(&avc_resize_mutex);
+	avc_cache_threshold = threshold;
+	avc_threshold_pinned = true;
+	mutex_unlock(&avc_resize_mutex);
+}
+
 static struct avc_node *avc_alloc_node(void)
 {
 	struct avc_node *node;
@@ -557,7 +743,7 @@ static struct avc_node *avc_alloc_node(void)
 	avc_cache_stats_incr(allocations);
 
 	if (atomic_inc_return(&avc_cache.active_nodes) > avc_cache_threshold)
-		avc_reclaim_node();
+		avc_check_thrash(avc_reclaim_node());
 
 out:
 	return node;
@@ -574,11 +760,9 @@ static void avc_node_populate(struct avc_node *node, u32 ssid, u32 tsid, u16 tcl
 static inline struct avc_node *avc_search_node(u32 ssid, u32 tsid, u16 tclass)
 {
 	struct avc_node *node, *ret = NULL;
-	int hvalue;
 	struct hlist_head *head;
 
-	hvalue = avc_hash(ssid, tsid, tclass);
-	head = &avc_cache.slots[hvalue];
+	head = &avc_hash(avc_table(), ssid, tsid, tclass)->head;
 	hlist_for_each_entry_rcu(node, head, list) {
 		if (ssid == node->ae.ssid &&
 		    tclass == node->ae.tclass &&
@@ -662,7 +846,7 @@ static struct avc_node *avc_insert(u32 ssid, u32 tsid, u16 tclass,
 				struct avc_xperms_node *xp_node)
 {
 	struct avc_node *pos, *node = NULL;
-	int hvalue;
+	struct avc_slot *slot;
 	unsigned long flag;
 
 	if (avc_latest_notif_update(avd->seqno, 1))
@@ -674,15 +858,15 @@ static struct avc_node *avc_insert(u32 ssid, u32 tsid, u16 tclass,
 		spinlock_t *lock;
 		int rc = 0;
 
-		hvalue = avc_hash(ssid, tsid, tclass);
 		avc_node_populate(node, ssid, tsid, tclass, avd);
 		rc = avc_xperms_populate(node, xp_node);
 		if (rc) {
-			kmem_cache_free(avc_node_cachep, node);
+			avc_node_kill(node);
 			return NULL;
 		}
-		head = &avc_cache.slots[hvalue];
-		lock = &avc_cache.slots_lock[hvalue];
+		slot = avc_hash(avc_table(), ssid, tsid, tclass);
+		head = &slot->head;
+		lock = &slot->lock;
 
 		spin_lock_irqsave(lock, flag);
 		hlist_for_each_entry(pos, head, list) {
@@ -830,9 +1014,10 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 			struct extended_perms_decision *xpd,
 			u32 flags)
 {
-	int hvalue, rc = 0;
+	int rc = 0;
 	unsigned long flag;
 	struct avc_node *pos, *node, *orig = NULL;
+	struct avc_slot *slot;
 	struct hlist_head *head;
 	spinlock_t *lock;
 
@@ -843,10 +1028,10 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 	}
 
 	/* Lock the target slot */
-	hvalue = avc_hash(ssid, tsid, tclass);
+	slot = avc_hash(avc_table(), ssid, tsid, tclass);
 
-	head = &avc_cache.slots[hvalue];
-	lock = &avc_cache.slots_lock[hvalue];
+	head = &slot->head;
+	lock = &slot->lock;
 
 	spin_lock_irqsave(lock, flag);
 
@@ -875,7 +1060,7 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 	if (orig->ae.xp_node) {
 		rc = avc_xperms_populate(node, orig->ae.xp_node);
 		if (rc) {
-			kmem_cache_free(avc_node_cachep, node);
+			avc_node_kill(node);
 			goto out_unlock;
 		}
 	}
@@ -918,27 +1103,33 @@ out:
  */
 static void avc_flush(void)
 {
+	struct avc_slots *table;
 	struct hlist_head *head;
 	struct avc_node *node;
 	spinlock_t *lock;
 	unsigned long flag;
 	int i;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-		head = &avc_cache.slots[i];
-		lock = &avc_cache.slots_lock[i];
+	/*
+	 * Holding rcu_read_lock() across the walk keeps a concurrent
+	 * resize from freeing the table under us.
+	 */
+	rcu_read_lock();
+	table = avc_table();
+	for (i = 0; i < table->size; i++) {
+		head = &table->slot[i].head;
+		lock = &table->slot[i].lock;
 
 		spin_lock_irqsave(lock, flag);
 		/*
 		 * With preemptable RCU, the outer spinlock does not
 		 * prevent RCU grace periods from ending.
 		 */
-		rcu_read_lock();
 		hlist_for_each_entry(node, head, list)
 			avc_node_delete(node);
-		rcu_read_unlock();
 		spin_unlock_irqrestore(lock, flag);
 	}
+	rcu_read_unlock();
 }
 
 /**
@@ -1187,3 +1378,117 @@ void avc_disable(void)
 		/* kmem_cache_destroy(avc_node_cachep); */
 	}
 }
+
+#ifdef CONFIG_SECURITY_SELINUX_AVC_SELFTEST
+/*
+ * Replay a synthetic access trace through the cache.  SIDs are taken
+ * from the top of the SID space and the class is out of range, so the
+ * entries can't be confused with real decisions.  Afterwards the cache
+ * gets its threshold and table size back and only the synthetic
+ * entries are dropped, leaving the cache as the trace found it.
+ */
+#define AVC_SELFTEST_PAIRS	2048
+#define AVC_SELFTEST_ACCESSES	(64 * 1024)
+#define AVC_SELFTEST_SID_BASE	0xfff00000U
+#define AVC_SELFTEST_TCLASS	0xfffe
+
+static u32 __init avc_selftest_allowed(u32 ssid, u32 tsid)
+{
+	return jhash_2words(ssid, tsid, 0x5e1f7e57);
+}
+
+static void __init avc_selftest_purge(void)
+{
+	struct avc_slots *table;
+	struct avc_node *node;
+	unsigned long flag;
+	int i;
+
+	rcu_read_lock();
+	table = avc_table();
+	for (i = 0; i < table->size; i++) {
+		spin_lock_irqsave(&table->slot[i].lock, flag);
+		hlist_for_each_entry(node, &table->slot[i].head, list)
+			if (node->ae.tclass == AVC_SELFTEST_TCLASS)
+				avc_node_delete(node);
+		spin_unlock_irqrestore(&table->slot[i].lock, flag);
+	}
+	rcu_read_unlock();
+}
+
+static int __init avc_selftest(void)
+{
+	struct avc_xperms_node xp_node;
+	struct av_decision avd;
+	struct avc_node *node;
+	unsigned int i, hits = 0, errors = 0;
+	unsigned int threshold, size, resizes;
+	u32 rnd = 1;
+
+	if (!selinux_enabled)
+		return 0;
+
+	mutex_lock(&avc_resize_mutex);
+	threshold = avc_cache_threshold;
+	size = avc_table_locked()->size;
+	resizes = avc_cache.resizes;
+	mutex_unlock(&avc_resize_mutex);
+
+	memset(&xp_node, 0, sizeof(xp_node));
+	INIT_LIST_HEAD(&xp_node.xpd_head);
+
+	for (i = 0; i < AVC_SELFTEST_ACCESSES; i++) {
+		u32 a, b, pair, ssid, tsid;
+
+		/*
+		 * The product of two uniform picks skews the trace
+		 * towards a hot subset of pairs, like a real system
+		 * where a few domains do most of the accesses.
+		 */
+		rnd = rnd * 1103515245 + 12345;
+		a = (rnd >> 16) % AVC_SELFTEST_PAIRS;
+		rnd = rnd * 1103515245 + 12345;
+		b = (rnd >> 16) % AVC_SELFTEST_PAIRS;
+		pair = a * b / AVC_SELFTEST_PAIRS;
+
+		ssid = AVC_SELFTEST_SID_BASE + (pair >> 4);
+		tsid = AVC_SELFTEST_SID_BASE + pair;
+
+		rcu_read_lock();
+		node = avc_search_node(ssid, tsid, AVC_SELFTEST_TCLASS);
+		if (node) {
+			hits++;
+			if (node->ae.avd.allowed != avc_selftest_allowed(ssid, tsid))
+				errors++;
+		} else {
+			memset(&avd, 0, sizeof(avd));
+			avd.allowed = avc_selftest_allowed(ssid, tsid);
+			avd.seqno = avc_cache.latest_notif;
+			avc_insert(ssid, tsid, AVC_SELFTEST_TCLASS, &avd, &xp_node);
+		}
+		rcu_read_unlock();
+
+		if (!(i & 1023))
+			cond_resched();
+	}
+
+	/* let any growth triggered by the trace finish before restoring */
+	flush_work(&avc_resize_work);
+
+	mutex_lock(&avc_resize_mutex);
+	printk(KERN_INFO "SELinux: avc selftest: %u accesses, %u hits, "
+	       "%u errors, threshold %u, %u resizes\n", AVC_SELFTEST_ACCESSES,
+	       hits, errors, avc_cache_threshold, avc_cache.resizes - resizes);
+	WARN_ON(errors);
+
+	avc_cache_threshold = threshold;
+	avc_cache.resizes = resizes;
+	if (avc_table_locked()->size != size)
+		avc_replace_table(size);
+	mutex_unlock(&avc_resize_mutex);
+
+	avc_selftest_purge();
+	return 0;
+}
+late_initcall(avc_selftest);
+#endif
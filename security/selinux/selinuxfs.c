@@ -1342,7 +1342,12 @@ static ssize_t sel_write_avc_cache_threshold(struct file *file,
 	if (sscanf(page, "%u", &new_value) != 1)
 		goto out;
 
-	avc_cache_threshold = new_value;
+	/*
+	 * Pins the threshold: the AVC stops growing by itself.  Automatic
+	 * growth swaps in a larger hash table and flushes every cached
+	 * decision, so pin it where that refill cost is unwelcome.
+	 */
+	avc_set_cache_threshold(new_value);
 
 	ret = count;
 out:
@@ -20,16 +20,49 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/errno.h>
+#include <linux/bitops.h>
 #include "avtab.h"
 #include "policydb.h"
 
 static struct kmem_cache *avtab_node_cachep;
 static struct kmem_cache *avtab_xperms_cachep;
 
+/*
+ * MurmurHash3 over the three key words.  The old shift-and-add hash
+ * left most buckets empty once the table grew past a few thousand
+ * slots, since source_type << 9 only reaches the top mask bits.
+ */
 static inline int avtab_hash(struct avtab_key *keyp, u16 mask)
 {
-	return ((keyp->target_class + (keyp->target_type << 2) +
-		 (keyp->source_type << 9)) & mask);
+	static const u32 c1 = 0xcc9e2d51;
+	static const u32 c2 = 0x1b873593;
+	static const u32 m = 5;
+	static const u32 n = 0xe6546b64;
+	u32 hash = 0;
+
+#define mix(input) {				\
+	u32 v = input;				\
+	v *= c1;				\
+	v = rol32(v, 15);			\
+	v *= c2;				\
+	hash ^= v;				\
+	hash = rol32(hash, 13);			\
+	hash = hash * m + n;			\
+}
+
+	mix(keyp->target_class);
+	mix(keyp->target_type);
+	mix(keyp->source_type);
+
+#undef mix
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+
+	return hash & mask;
 }
 
 static struct avtab_node*
@@ -39,7 +72,11 @@ avtab_insert_node(struct avtab *h, int hvalue,
 {
 	struct avtab_node *newnode;
 	struct avtab_extended_perms *xperms;
-	newnode = kmem_cache_zalloc(avtab_node_cachep, GFP_KERNEL);
+
+	if (h->pool)
+		newnode = flex_array_get(h->pool, h->nel);
+	else
+		newnode = kmem_cache_zalloc(avtab_node_cachep, GFP_KERNEL);
 	if (newnode == NULL)
 		return NULL;
 	newnode->key = *key;
@@ -47,7 +84,8 @@ avtab_insert_node(struct avtab *h, int hvalue,
 	if (key->specified & AVTAB_XPERMS) {
 		xperms = kmem_cache_zalloc(avtab_xperms_cachep, GFP_KERNEL);
 		if (xperms == NULL) {
-			kmem_cache_free(avtab_node_cachep, newnode);
+			if (!h->pool)
+				kmem_cache_free(avtab_node_cachep, newnode);
 			return NULL;
 		}
 		*xperms = *(datum->u.xperms);
@@ -253,12 +291,17 @@ void avtab_destroy(struct avtab *h)
 			if (temp->key.specified & AVTAB_XPERMS)
 				kmem_cache_free(avtab_xperms_cachep,
 						temp->datum.u.xperms);
-			kmem_cache_free(avtab_node_cachep, temp);
+			if (!h->pool)
+				kmem_cache_free(avtab_node_cachep, temp);
 		}
 		h->htable[i] = NULL;
 	}
 	kfree(h->htable);
 	h->htable = NULL;
+	if (h->pool) {
+		flex_array_free(h->pool);
+		h->pool = NULL;
+	}
 	h->nslot = 0;
 	h->mask = 0;
 }
@@ -267,9 +310,30 @@ int avtab_init(struct avtab *h)
 {
 	h->htable = NULL;
 	h->nel = 0;
+	h->pool = NULL;
 	return 0;
 }
 
+/*
+ * The base table's rule count is known up front, so take all of its
+ * nodes from one preallocated array instead of one slab object per
+ * rule.  This saves tens of thousands of allocations per policy load
+ * and packs the nodes into whole pages.  If the array cannot be had,
+ * fall back to the node cache.
+ */
+static void avtab_alloc_pool(struct avtab *h, u32 nrules)
+{
+	h->pool = flex_array_alloc(sizeof(struct avtab_node), nrules,
+				   GFP_KERNEL | __GFP_ZERO);
+	if (!h->pool)
+		return;
+	if (flex_array_prealloc(h->pool, 0, nrules,
+				GFP_KERNEL | __GFP_ZERO)) {
+		flex_array_free(h->pool);
+		h->pool = NULL;
+	}
+}
+
 int avtab_alloc(struct avtab *h, u32 nrules)
 {
 	u16 mask = 0;
@@ -583,6 +647,13 @@ int avtab_read(struct avtab *a, void *fp, struct policydb *pol)
 	if (rc)
 		goto bad;
 
+	/*
+	 * From POLICYDB_VERSION_AVTAB on every item is a single rule, so
+	 * nel bounds the number of nodes.
+	 */
+	if (pol->policyvers >= POLICYDB_VERSION_AVTAB)
+		avtab_alloc_pool(a, nel);
+
 	for (i = 0; i < nel; i++) {
 		rc = avtab_read_item(a, fp, pol, avtab_insertf, NULL);
 		if (rc) {
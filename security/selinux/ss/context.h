@@ -15,6 +15,7 @@
 #ifndef _SS_CONTEXT_H_
 #define _SS_CONTEXT_H_
 
+#include <linux/jhash.h>
 #include "ebitmap.h"
 #include "mls_types.h"
 #include "security.h"
@@ -159,5 +160,23 @@ static inline int context_cmp(struct context *c1, struct context *c2)
 		mls_context_cmp(c1, c2));
 }
 
+/*
+ * Hash the fields that context_cmp() looks at: unmapped contexts
+ * compare by string alone, mapped ones by user, role, type and range.
+ */
+static inline u32 context_compute_hash(struct context *c)
+{
+	u32 hash;
+
+	if (c->len)
+		return jhash(c->str, strlen(c->str), c->len);
+
+	hash = jhash_3words(c->user, c->role, c->type, 0);
+	hash = jhash_2words(c->range.level[0].sens,
+			    c->range.level[1].sens, hash);
+	hash = ebitmap_hash(&c->range.level[0].cat, hash);
+	return ebitmap_hash(&c->range.level[1].cat, hash);
+}
+
 #endif	/* _SS_CONTEXT_H_ */
 
@@ -18,6 +18,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/errno.h>
+#include <linux/jhash.h>
 #include <net/netlabel.h>
 #include "ebitmap.h"
 #include "policydb.h"
@@ -46,6 +47,21 @@ int ebitmap_cmp(struct ebitmap *e1, struct ebitmap *e2)
 	return 1;
 }
 
+/*
+ * Hash the node layout as well as the bits, which is exactly what
+ * ebitmap_cmp() compares, so equal bitmaps always hash alike.
+ */
+u32 ebitmap_hash(struct ebitmap *e, u32 hash)
+{
+	struct ebitmap_node *n;
+
+	for (n = e->node; n; n = n->next) {
+		hash = jhash_1word(n->startbit, hash);
+		hash = jhash(n->maps, sizeof(n->maps), hash);
+	}
+	return hash;
+}
+
 int ebitmap_cpy(struct ebitmap *dst, struct ebitmap *src)
 {
 	struct ebitmap_node *n, *new, *prev;
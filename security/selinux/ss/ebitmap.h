@@ -116,6 +116,7 @@ static inline void ebitmap_node_clr_bit(struct ebitmap_node *n,
 	     bit = ebitmap_next_positive(e, &n, bit))	\
 
 int ebitmap_cmp(struct ebitmap *e1, struct ebitmap *e2);
+u32 ebitmap_hash(struct ebitmap *e, u32 hash);
 int ebitmap_cpy(struct ebitmap *dst, struct ebitmap *src);
 int ebitmap_contains(struct ebitmap *e1, struct ebitmap *e2);
 int ebitmap_get_bit(struct ebitmap *e, unsigned long bit);
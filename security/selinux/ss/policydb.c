@@ -32,6 +32,7 @@
 #include <linux/errno.h>
 #include <linux/audit.h>
 #include <linux/flex_array.h>
+#include <linux/vmalloc.h>
 #include "security.h"
 
 #include "policydb.h"
@@ -782,6 +783,29 @@ static void ocontext_destroy(struct ocontext *c, int i)
 	kfree(c);
 }
 
+/*
+ * The flattened arrays can run to a few hundred kilobytes on large
+ * policies, so do not insist on physically contiguous memory.
+ */
+static void *policydb_flat_alloc(size_t size)
+{
+	void *ptr = NULL;
+
+	if (size <= PAGE_SIZE << PAGE_ALLOC_COSTLY_ORDER)
+		ptr = kmalloc(size, GFP_KERNEL | __GFP_NOWARN);
+	if (!ptr)
+		ptr = vmalloc(size);
+	return ptr;
+}
+
+static void policydb_flat_free(void *ptr)
+{
+	if (is_vmalloc_addr(ptr))
+		vfree(ptr);
+	else
+		kfree(ptr);
+}
+
 /*
  * Free any memory allocated by a policy database structure.
  */
@@ -872,6 +896,8 @@ void policydb_destroy(struct policydb *p)
 		}
 		flex_array_free(p->type_attr_map_array);
 	}
+	policydb_flat_free(p->type_attr_idx);
+	policydb_flat_free(p->type_attr_vals);
 
 	ebitmap_destroy(&p->filename_trans_ttypes);
 	ebitmap_destroy(&p->policycaps);
@@ -2279,6 +2305,44 @@ out:
 	return rc;
 }
 
+/*
+ * Copy each type's attribute ebitmap into one contiguous array of
+ * values, so that the nested per-attribute loops of the access
+ * computation walk plain arrays instead of ebitmap node lists.
+ */
+static int type_attr_flatten(struct policydb *p)
+{
+	struct ebitmap *e;
+	struct ebitmap_node *node;
+	u32 i, bit, nel = 0;
+
+	p->type_attr_idx = policydb_flat_alloc((p->p_types.nprim + 1) *
+					       sizeof(*p->type_attr_idx));
+	if (!p->type_attr_idx)
+		return -ENOMEM;
+
+	for (i = 0; i < p->p_types.nprim; i++) {
+		e = flex_array_get(p->type_attr_map_array, i);
+		p->type_attr_idx[i] = nel;
+		ebitmap_for_each_positive_bit(e, node, bit)
+			nel++;
+	}
+	p->type_attr_idx[i] = nel;
+
+	p->type_attr_vals = policydb_flat_alloc(nel *
+						sizeof(*p->type_attr_vals));
+	if (!p->type_attr_vals)
+		return -ENOMEM;
+
+	nel = 0;
+	for (i = 0; i < p->p_types.nprim; i++) {
+		e = flex_array_get(p->type_attr_map_array, i);
+		ebitmap_for_each_positive_bit(e, node, bit)
+			p->type_attr_vals[nel++] = bit;
+	}
+	return 0;
+}
+
 /*
  * Read the configuration data from a policy database binary
  * representation file into a policy database structure.
@@ -2556,6 +2620,10 @@ int policydb_read(struct policydb *p, void *fp)
 			goto bad;
 	}
 
+	rc = type_attr_flatten(p);
+	if (rc)
+		goto bad;
+
 	rc = policydb_bounds_sanity_check(p);
 	if (rc)
 		goto bad;
@@ -285,6 +285,14 @@ struct policydb {
 	/* type -> attribute reverse mapping */
 	struct flex_array *type_attr_map_array;
 
+	/*
+	 * type_attr_map_array flattened for access computations: the
+	 * attributes of type t (0-based) are type_attr_vals[i] for
+	 * type_attr_idx[t] <= i < type_attr_idx[t + 1].
+	 */
+	u32 *type_attr_idx;
+	u16 *type_attr_vals;
+
 	struct ebitmap policycaps;
 
 	struct ebitmap permissive_map;
@@ -310,6 +318,13 @@ extern int policydb_role_isvalid(struct policydb *p, unsigned int role);
 extern int policydb_read(struct policydb *p, void *fp);
 extern int policydb_write(struct policydb *p, void *fp);
 
+static inline const u16 *policydb_type_attrs(struct policydb *p, u32 type,
+					     u32 *nel)
+{
+	*nel = p->type_attr_idx[type + 1] - p->type_attr_idx[type];
+	return p->type_attr_vals + p->type_attr_idx[type];
+}
+
 #define PERM_SYMTAB_SIZE 32
 
 #define POLICYDB_CONFIG_MLS    1
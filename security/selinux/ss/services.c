@@ -52,6 +52,7 @@
 #include <linux/selinux.h>
 #include <linux/flex_array.h>
 #include <linux/vmalloc.h>
+#include <linux/ktime.h>
 #include <net/netlabel.h>
 
 #include "flask.h"
@@ -655,8 +656,8 @@ static void context_struct_compute_av(struct context *scontext,
 	struct avtab_key avkey;
 	struct avtab_node *node;
 	struct class_datum *tclass_datum;
-	struct ebitmap *sattr, *tattr;
-	struct ebitmap_node *snode, *tnode;
+	const u16 *sattr, *tattr;
+	u32 nsattr, ntattr;
 	unsigned int i, j;
 
 	avd->allowed = 0;
@@ -681,14 +682,12 @@ static void context_struct_compute_av(struct context *scontext,
 	 */
 	avkey.target_class = tclass;
 	avkey.specified = AVTAB_AV | AVTAB_XPERMS;
-	sattr = flex_array_get(policydb.type_attr_map_array, scontext->type - 1);
-	BUG_ON(!sattr);
-	tattr = flex_array_get(policydb.type_attr_map_array, tcontext->type - 1);
-	BUG_ON(!tattr);
-	ebitmap_for_each_positive_bit(sattr, snode, i) {
-		ebitmap_for_each_positive_bit(tattr, tnode, j) {
-			avkey.source_type = i + 1;
-			avkey.target_type = j + 1;
+	sattr = policydb_type_attrs(&policydb, scontext->type - 1, &nsattr);
+	tattr = policydb_type_attrs(&policydb, tcontext->type - 1, &ntattr);
+	for (i = 0; i < nsattr; i++) {
+		for (j = 0; j < ntattr; j++) {
+			avkey.source_type = sattr[i] + 1;
+			avkey.target_type = tattr[j] + 1;
 			for (node = avtab_search_node(&policydb.te_avtab, &avkey);
 			     node;
 			     node = avtab_search_node_next(node, avkey.specified)) {
@@ -999,8 +998,8 @@ void security_compute_xperms_decision(u32 ssid,
 	struct context *scontext, *tcontext;
 	struct avtab_key avkey;
 	struct avtab_node *node;
-	struct ebitmap *sattr, *tattr;
-	struct ebitmap_node *snode, *tnode;
+	const u16 *sattr, *tattr;
+	u32 nsattr, ntattr;
 	unsigned int i, j;
 
 	xpermd->driver = driver;
@@ -1042,16 +1041,12 @@ void security_compute_xperms_decision(u32 ssid,
 
 	avkey.target_class = tclass;
 	avkey.specified = AVTAB_XPERMS;
-	sattr = flex_array_get(policydb.type_attr_map_array,
-				scontext->type - 1);
-	BUG_ON(!sattr);
-	tattr = flex_array_get(policydb.type_attr_map_array,
-				tcontext->type - 1);
-	BUG_ON(!tattr);
-	ebitmap_for_each_positive_bit(sattr, snode, i) {
-		ebitmap_for_each_positive_bit(tattr, tnode, j) {
-			avkey.source_type = i + 1;
-			avkey.target_type = j + 1;
+	sattr = policydb_type_attrs(&policydb, scontext->type - 1, &nsattr);
+	tattr = policydb_type_attrs(&policydb, tcontext->type - 1, &ntattr);
+	for (i = 0; i < nsattr; i++) {
+		for (j = 0; j < ntattr; j++) {
+			avkey.source_type = sattr[i] + 1;
+			avkey.target_type = tattr[j] + 1;
 			for (node = avtab_search_node(&policydb.te_avtab, &avkey);
 			     node;
 			     node = avtab_search_node_next(node, avkey.specified))
@@ -2013,6 +2008,7 @@ int security_load_policy(void *data, size_t len)
 	u16 map_size;
 	int rc = 0;
 	struct policy_file file = { data, len }, *fp = &file;
+	ktime_t start = ktime_get();
 
 	if (!ss_initialized) {
 		avtab_cache_init();
@@ -2021,6 +2017,8 @@ int security_load_policy(void *data, size_t len)
 			avtab_cache_destroy();
 			return rc;
 		}
+		pr_debug("SELinux:  policy read in %lld usecs\n",
+			 ktime_us_delta(ktime_get(), start));
 
 		policydb.len = len;
 		rc = selinux_set_mapping(&policydb, secclass_map,
@@ -2042,6 +2040,8 @@ int security_load_policy(void *data, size_t len)
 		security_load_policycaps();
 		ss_initialized = 1;
 		seqno = ++latest_granting;
+		pr_debug("SELinux:  policy loaded in %lld usecs\n",
+			 ktime_us_delta(ktime_get(), start));
 		selinux_complete_init();
 		avc_ss_reset(seqno);
 		selnl_notify_policyload(seqno);
@@ -2058,6 +2058,8 @@ int security_load_policy(void *data, size_t len)
 	rc = policydb_read(&newpolicydb, fp);
 	if (rc)
 		return rc;
+	pr_debug("SELinux:  policy read in %lld usecs\n",
+		 ktime_us_delta(ktime_get(), start));
 
 	newpolicydb.len = len;
 	/* If switching between different policy types, log MLS status */
@@ -2103,6 +2105,7 @@ int security_load_policy(void *data, size_t len)
 			" table\n");
 		goto err;
 	}
+	sidtab_rehash_contexts(&newsidtab);
 
 	/* Save the old policydb and SID table to free later. */
 	memcpy(&oldpolicydb, &policydb, sizeof policydb);
@@ -2119,6 +2122,9 @@ int security_load_policy(void *data, size_t len)
 	seqno = ++latest_granting;
 	write_unlock_irq(&policy_rwlock);
 
+	pr_debug("SELinux:  policy reloaded in %lld usecs\n",
+		 ktime_us_delta(ktime_get(), start));
+
 	/* Free the old policydb and SID table. */
 	policydb_destroy(&oldpolicydb);
 	sidtab_destroy(&oldsidtab);
@@ -14,6 +14,9 @@
 #define SIDTAB_HASH(sid) \
 (sid & SIDTAB_HASH_MASK)
 
+#define SIDTAB_CTX_HASH(hash) \
+((hash) & (SIDTAB_CTX_SIZE - 1))
+
 int sidtab_init(struct sidtab *s)
 {
 	int i;
@@ -23,6 +26,13 @@ int sidtab_init(struct sidtab *s)
 		return -ENOMEM;
 	for (i = 0; i < SIDTAB_SIZE; i++)
 		s->htable[i] = NULL;
+	s->ctxtable = kcalloc(SIDTAB_CTX_SIZE, sizeof(*(s->ctxtable)),
+			      GFP_ATOMIC);
+	if (!s->ctxtable) {
+		kfree(s->htable);
+		s->htable = NULL;
+		return -ENOMEM;
+	}
 	s->nel = 0;
 	s->next_sid = 1;
 	s->shutdown = 0;
@@ -30,6 +40,17 @@ int sidtab_init(struct sidtab *s)
 	return 0;
 }
 
+static void sidtab_link_context(struct sidtab *s, struct sidtab_node *node)
+{
+	u32 cvalue;
+
+	node->ctx_hash = context_compute_hash(&node->context);
+	cvalue = SIDTAB_CTX_HASH(node->ctx_hash);
+	node->ctx_next = s->ctxtable[cvalue];
+	wmb();
+	s->ctxtable[cvalue] = node;
+}
+
 int sidtab_insert(struct sidtab *s, u32 sid, struct context *context)
 {
 	int hvalue, rc = 0;
@@ -74,6 +95,7 @@ int sidtab_insert(struct sidtab *s, u32 sid, struct context *context)
 		wmb();
 		s->htable[hvalue] = newnode;
 	}
+	sidtab_link_context(s, newnode);
 
 	s->nel++;
 	if (sid >= s->next_sid)
@@ -159,19 +181,16 @@ static void sidtab_update_cache(struct sidtab *s, struct sidtab_node *n, int loc
 }
 
 static inline u32 sidtab_search_context(struct sidtab *s,
-						  struct context *context)
+					struct context *context, u32 hash)
 {
-	int i;
 	struct sidtab_node *cur;
 
-	for (i = 0; i < SIDTAB_SIZE; i++) {
-		cur = s->htable[i];
-		while (cur) {
-			if (context_cmp(&cur->context, context)) {
-				sidtab_update_cache(s, cur, SIDTAB_CACHE_LEN - 1);
-				return cur->sid;
-			}
-			cur = cur->next;
+	for (cur = s->ctxtable[SIDTAB_CTX_HASH(hash)]; cur;
+	     cur = cur->ctx_next) {
+		if (cur->ctx_hash == hash &&
+		    context_cmp(&cur->context, context)) {
+			sidtab_update_cache(s, cur, SIDTAB_CACHE_LEN - 1);
+			return cur->sid;
 		}
 	}
 	return 0;
@@ -198,19 +217,20 @@ int sidtab_context_to_sid(struct sidtab *s,
 			  struct context *context,
 			  u32 *out_sid)
 {
-	u32 sid;
+	u32 sid, hash;
 	int ret = 0;
 	unsigned long flags;
 
 	*out_sid = SECSID_NULL;
 
+	hash = context_compute_hash(context);
 	sid  = sidtab_search_cache(s, context);
 	if (!sid)
-		sid = sidtab_search_context(s, context);
+		sid = sidtab_search_context(s, context, hash);
 	if (!sid) {
 		spin_lock_irqsave(&s->lock, flags);
 		/* Rescan now that we hold the lock. */
-		sid = sidtab_search_context(s, context);
+		sid = sidtab_search_context(s, context, hash);
 		if (sid)
 			goto unlock_out;
 		/* No SID exists for the context.  Allocate a new one. */
@@ -237,6 +257,25 @@ unlock_out:
 	return 0;
 }
 
+/*
+ * Rebuild the context index after the contexts of a table that is
+ * not yet visible to readers have been rewritten in place, as
+ * convert_context() does on policy reload.
+ */
+void sidtab_rehash_contexts(struct sidtab *s)
+{
+	int i;
+	struct sidtab_node *cur;
+
+	for (i = 0; i < SIDTAB_CTX_SIZE; i++)
+		s->ctxtable[i] = NULL;
+	for (i = 0; i < SIDTAB_SIZE; i++)
+		for (cur = s->htable[i]; cur; cur = cur->next)
+			sidtab_link_context(s, cur);
+	for (i = 0; i < SIDTAB_CACHE_LEN; i++)
+		s->cache[i] = NULL;
+}
+
 void sidtab_hash_eval(struct sidtab *h, char *tag)
 {
 	int i, chain_len, slots_used, max_chain_len;
@@ -262,6 +301,27 @@ void sidtab_hash_eval(struct sidtab *h, char *tag)
 	printk(KERN_DEBUG "%s:  %d entries and %d/%d buckets used, longest "
 	       "chain length %d\n", tag, h->nel, slots_used, SIDTAB_SIZE,
 	       max_chain_len);
+
+	slots_used = 0;
+	max_chain_len = 0;
+	for (i = 0; i < SIDTAB_CTX_SIZE; i++) {
+		cur = h->ctxtable[i];
+		if (cur) {
+			slots_used++;
+			chain_len = 0;
+			while (cur) {
+				chain_len++;
+				cur = cur->ctx_next;
+			}
+
+			if (chain_len > max_chain_len)
+				max_chain_len = chain_len;
+		}
+	}
+
+	printk(KERN_DEBUG "%s:  %d/%d context buckets used, longest "
+	       "chain length %d\n", tag, slots_used, SIDTAB_CTX_SIZE,
+	       max_chain_len);
 }
 
 void sidtab_destroy(struct sidtab *s)
@@ -284,6 +344,8 @@ void sidtab_destroy(struct sidtab *s)
 	}
 	kfree(s->htable);
 	s->htable = NULL;
+	kfree(s->ctxtable);
+	s->ctxtable = NULL;
 	s->nel = 0;
 	s->next_sid = 1;
 }
@@ -295,6 +357,7 @@ void sidtab_set(struct sidtab *dst, struct sidtab *src)
 
 	spin_lock_irqsave(&src->lock, flags);
 	dst->htable = src->htable;
+	dst->ctxtable = src->ctxtable;
 	dst->nel = src->nel;
 	dst->next_sid = src->next_sid;
 	dst->shutdown = 0;
@@ -1,6 +1,8 @@
 /*
  * A security identifier table (sidtab) is a hash table
  * of security context structures indexed by SID value.
+ * A second set of chains indexes the same nodes by a
+ * hash of the context, for context to SID lookups.
  *
  * Author : Stephen Smalley, <sds@epoch.ncsc.mil>
  */
@@ -13,6 +15,8 @@ struct sidtab_node {
 	u32 sid;		/* security identifier */
 	struct context context;	/* security context structure */
 	struct sidtab_node *next;
+	u32 ctx_hash;		/* context_compute_hash(&context) */
+	struct sidtab_node *ctx_next;
 };
 
 #define SIDTAB_HASH_BITS 7
@@ -21,8 +25,12 @@ struct sidtab_node {
 
 #define SIDTAB_SIZE SIDTAB_HASH_BUCKETS
 
+#define SIDTAB_CTX_HASH_BITS 9
+#define SIDTAB_CTX_SIZE (1 << SIDTAB_CTX_HASH_BITS)
+
 struct sidtab {
 	struct sidtab_node **htable;
+	struct sidtab_node **ctxtable;	/* indexed by context hash */
 	unsigned int nel;	/* number of elements */
 	unsigned int next_sid;	/* next SID to allocate */
 	unsigned char shutdown;
@@ -46,6 +54,7 @@ int sidtab_context_to_sid(struct sidtab *s,
 			  struct context *context,
 			  u32 *sid);
 
+void sidtab_rehash_contexts(struct sidtab *s);
 void sidtab_hash_eval(struct sidtab *h, char *tag);
 void sidtab_destroy(struct sidtab *s);
 void sidtab_set(struct sidtab *dst, struct sidtab *src);